@@ -0,0 +1,142 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Acquisition.h"
+#include "pico/multicore.h"
+#include "Profiler.h"
+
+Acquisition *Acquisition::core1Acquisition = NULL;
+
+void Acquisition::start()
+{
+    if(started) return;
+    started = true;
+    core1Acquisition = this;
+    multicore_launch_core1(core1Entry);
+}
+
+void Acquisition::core1Entry()
+{
+    core1Acquisition->run();
+}
+
+// Core1 main loop. The sampling timer and DMA interrupts are set up from here so they run on core1.
+void Acquisition::run()
+{
+    PROFILE_START_CORE();
+    Capture capture(0);
+    capture.startCapture(NULL);     // Start the sampling timer
+    EdgeCounter edgeCounter(FREQ_COUNTER_PIN);
+    edgeCounter.start(Capture::timerAlarmPool);
+
+    CapturedData *activeCapture = NULL;
+    MeterReading reading;
+    uint64_t lastMeterUpdate = time_us_64();
+    uint32_t streamInterval = 0;
+    bool streamChange = false;
+    bool precisionRequested = false;
+    bool precisionRequest;
+    SpectrumBlock *spectrumBlock = NULL;
+    RollRequest rollRequest;
+    bool rollChange = false;
+
+    while(true)
+    {
+        if(activeCapture && !capture.captureInProgress)
+        {
+            // The completed queue holds every frame there is, so this never fails
+            completedQueue.push(activeCapture);
+            activeCapture = NULL;
+        }
+        if(streamQueue.pop(streamInterval)) streamChange = true;
+        if(streamChange && !activeCapture && !voltmeter.isRunning() && !spectrumBurst.isRunning())
+        {
+            // The ADC is handed over between captures
+            streamer.stop();
+            capture.lendAdc(streamInterval != 0);
+            if(streamInterval != 0 && !streamer.start(streamInterval, &capture)) capture.lendAdc(false);
+            streamChange = false;
+        }
+        // Precision readings also borrow the ADC between captures
+        if(precisionQueue.pop(precisionRequest)) precisionRequested = true;
+        if(precisionRequested && !activeCapture && !streamChange && !streamer.isRunning() && !voltmeter.isRunning() && !spectrumBurst.isRunning())
+        {
+            capture.lendAdc(true);
+            precisionRequested = false;
+            if(!voltmeter.start())
+            {
+                capture.lendAdc(false);
+                precisionResultQueue.push(PrecisionReading());  // No DMA channel - an empty reading says so
+            }
+        }
+        PrecisionReading precisionReading;
+        if(voltmeter.finish(precisionReading, &capture))
+        {
+            capture.lendAdc(false);
+            precisionResultQueue.push(precisionReading);    // Only one is ever outstanding
+        }
+        // And so do spectrum blocks
+        if(!spectrumBlock) spectrumQueue.pop(spectrumBlock);
+        if(spectrumBlock && !spectrumBurst.isRunning() && !activeCapture && !streamChange && !streamer.isRunning() && !voltmeter.isRunning())
+        {
+            capture.lendAdc(true);
+            if(!spectrumBurst.start(spectrumBlock->samples, spectrumBlock->points, spectrumBlock->sampleIntervalNs))
+            {
+                capture.lendAdc(false);
+                spectrumBlock->points = 0;      // No DMA channel
+                spectrumResultQueue.push(spectrumBlock);
+                spectrumBlock = NULL;
+            }
+        }
+        if(spectrumBurst.finish(&capture))
+        {
+            capture.lendAdc(false);
+            spectrumBlock->sampleIntervalNs = spectrumBurst.getSampleIntervalNs();
+            spectrumResultQueue.push(spectrumBlock);
+            spectrumBlock = NULL;
+        }
+        // Roll mode takes over the timer engine between captures
+        if(rollRequestQueue.pop(rollRequest)) rollChange = true;
+        if(rollChange && !activeCapture)
+        {
+            capture.stopRoll();
+            if(rollRequest.divisor != 0) capture.startRoll(&rollQueue, rollRequest.divisor, rollRequest.acquireMode);
+            rollChange = false;
+        }
+        if(!activeCapture && !rollChange && !capture.isRolling() && !streamChange && !streamer.isRunning() && !voltmeter.isRunning() && !spectrumBurst.isRunning() && requestQueue.pop(activeCapture))
+        {
+            if(!capture.startCapture(activeCapture))
+            {
+                completedQueue.push(activeCapture);     // Hand it back untouched
+                activeCapture = NULL;
+            }
+        }
+
+        uint64_t currentTime = time_us_64();
+        if(currentTime - lastMeterUpdate > METERUPDATEUS && !meterQueue.full())
+        {
+            // Only read the peak when it can be delivered - reading it resets it
+            reading.frequency = capture.getFrequency();
+            reading.edgeFrequency = edgeCounter.getFrequency();
+            reading.peakADC = capture.getPeakVoltage();
+            meterQueue.push(reading);
+            lastMeterUpdate = currentTime;
+        }
+        tight_loop_contents();
+    }
+}
@@ -0,0 +1,97 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ACQUISITION_H__
+#define __ACQUISITION_H__
+
+// Runs the Capture engine on core1. The UI core hands empty CapturedData frames to core1 and receives
+// them back when they are complete, along with periodic meter readings. All traffic goes through
+// lock-free queues so neither core ever waits on the other.
+
+#include "Capture.h"
+#include "EdgeCounter.h"
+#include "SpscQueue.h"
+#include "Streamer.h"
+#include "Voltmeter.h"
+#include "Spectrum.h"
+
+#define METERUPDATEUS   50000LL     // How often core1 publishes meter readings
+
+typedef struct MeterReadingStruct
+{
+    FrequencyMeasurement frequency;     // Current frequency from the software (zero crossing) counter
+    uint32_t edgeFrequency = 0; // Current frequency in Hz from the hardware edge counter
+    uint16_t peakADC = 0;       // Peak ADC value since the previous reading
+} MeterReading;
+
+class Acquisition
+{
+    public:
+        // Launch core1. Call once from core0.
+        void start();
+        bool isStarted() { return started; }
+
+        // Core0 side. requestCapture passes ownership of the frame to core1 until it comes back from getCompletedCapture.
+        bool requestCapture(CapturedData *cds) { return requestQueue.push(cds); }
+        bool getCompletedCapture(CapturedData *&cds) { return completedQueue.pop(cds); }
+        bool getMeterReading(MeterReading &reading) { return meterQueue.pop(reading); }
+
+        // Stream the ADC continuously at the given interval, or stop with 0. Frame requests wait while streaming.
+        bool requestStream(uint32_t sampleIntervalNs) { return streamQueue.push(sampleIntervalNs); }
+        bool isStreaming() { return streamer.isRunning(); }
+        uint32_t getStreamIntervalNs() { return streamer.getSampleIntervalNs(); }
+        bool getStreamBlock(StreamBlock *&block) { return streamer.getBlock(block); }
+        void releaseStreamBlock(StreamBlock *block) { streamer.releaseBlock(block); }
+
+        // Take a precision voltmeter reading between captures. It waits while streaming.
+        bool requestPrecisionReading() { return precisionQueue.push(true); }
+        bool getPrecisionReading(PrecisionReading &reading) { return precisionResultQueue.pop(reading); }
+
+        // Fill a block of readings for the spectrum between captures, at the block's interval. Ownership passes
+        // to core1 until it comes back from getSpectrumBlock, with points 0 if it couldn't be taken. It waits while streaming.
+        bool requestSpectrumBlock(SpectrumBlock *block) { return spectrumQueue.push(block); }
+        bool getSpectrumBlock(SpectrumBlock *&block) { return spectrumResultQueue.pop(block); }
+
+        // Hand over each sample as the timer engine takes it (see Roll.h), or stop with a divisor of 0.
+        // Frame requests wait while rolling. The meters keep running.
+        bool requestRoll(const RollRequest &request) { return rollRequestQueue.push(request); }
+        bool getRollSample(RollSample &sample) { return rollQueue.pop(sample); }
+
+    private:
+        static Acquisition *core1Acquisition;
+        static void core1Entry();
+        void run();
+
+        bool started = false;
+
+        SpscQueue<CapturedData *, 4> requestQueue;      // Core0 -> core1: frames to fill
+        SpscQueue<CapturedData *, 4> completedQueue;    // Core1 -> core0: filled frames
+        SpscQueue<MeterReading, 8> meterQueue;          // Core1 -> core0: frequency and peak readings
+        SpscQueue<uint32_t, 4> streamQueue;             // Core0 -> core1: stream start (interval) and stop (0)
+        Streamer streamer;
+        SpscQueue<bool, 2> precisionQueue;              // Core0 -> core1: precision reading requests
+        SpscQueue<PrecisionReading, 2> precisionResultQueue;    // Core1 -> core0: precision readings
+        Voltmeter voltmeter;
+        SpscQueue<SpectrumBlock *, 2> spectrumQueue;            // Core0 -> core1: spectrum blocks to fill
+        SpscQueue<SpectrumBlock *, 2> spectrumResultQueue;      // Core1 -> core0: filled spectrum blocks
+        AdcBurst spectrumBurst;
+        SpscQueue<RollRequest, 4> rollRequestQueue;     // Core0 -> core1: roll start and stop
+        RollQueue rollQueue;                            // Core1 -> core0: roll samples, pushed by the sampling timer
+};
+
+#endif
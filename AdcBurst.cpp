@@ -0,0 +1,61 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "AdcBurst.h"
+#include "hardware/dma.h"
+
+bool AdcBurst::start(uint16_t *burstSamples, uint16_t burstCount, uint32_t sampleIntervalNs)
+{
+    if(running) return true;
+    if(dmaChannel < 0) dmaChannel = dma_claim_unused_channel(false);
+    if(dmaChannel < 0) return false;
+
+    dma_channel_config cfg = dma_channel_get_default_config(dmaChannel);
+    channel_config_set_transfer_data_size(&cfg, DMA_SIZE_16);
+    channel_config_set_read_increment(&cfg, false);
+    channel_config_set_write_increment(&cfg, true);
+    channel_config_set_dreq(&cfg, DREQ_ADC);
+
+    if(sampleIntervalNs < DMA_MIN_SAMPLE_INTERVAL_NS) sampleIntervalNs = DMA_MIN_SAMPLE_INTERVAL_NS;
+    if(sampleIntervalNs > DMA_MAX_SAMPLE_INTERVAL_NS) sampleIntervalNs = DMA_MAX_SAMPLE_INTERVAL_NS;
+    uint32_t adcClocks = (uint64_t)sampleIntervalNs * (ADC_CLOCK_HZ / 1000000) / 1000;
+    samples = burstSamples;
+    count = burstCount;
+    intervalNs = adcClocks * 1000 / (ADC_CLOCK_HZ / 1000000);
+
+    adc_fifo_setup(true, true, 1, false, false);    // Full 12 bit readings
+    adc_set_clkdiv(adcClocks - 1);                  // A conversion starts every (1 + div) ADC clocks
+    adc_fifo_drain();
+    dma_channel_configure(dmaChannel, &cfg, samples, &adc_hw->fifo, count, true);
+    startTime = time_us_64();
+    running = true;
+    adc_run(true);
+    return true;
+}
+
+bool AdcBurst::finish(Capture *meter)
+{
+    if(!running || dma_channel_is_busy(dmaChannel)) return false;
+    adc_run(false);
+    adc_fifo_setup(false, false, 0, false, false);
+    adc_fifo_drain();
+    adc_set_clkdiv(0);
+    running = false;
+    meter->meterBlock(samples, count, startTime, intervalNs);     // Thread mode - the sampling timer is still running the gates
+    return true;
+}
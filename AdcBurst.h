@@ -0,0 +1,50 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ADCBURST_H__
+#define __ADCBURST_H__
+
+// A one-off block of 12 bit ADC readings moved from the FIFO by DMA, for the precision voltmeter and the
+// spectrum analyzer. The burst runs on core1 between captures with the ADC lent to it, the same way the
+// streamer takes it. There is no interrupt - core1 polls for the end of the burst.
+
+#include "Capture.h"
+
+class AdcBurst
+{
+    public:
+        // Start count readings sampleIntervalNs apart (DMA_MIN_SAMPLE_INTERVAL_NS to DMA_MAX_SAMPLE_INTERVAL_NS)
+        // into samples. The ADC must be lent by the capture first.
+        bool start(uint16_t *samples, uint16_t count, uint32_t sampleIntervalNs);
+        bool isRunning() { return running; }
+        uint32_t getSampleIntervalNs() { return intervalNs; }   // The interval of the latest burst, in whole ADC clocks
+
+        // Returns true once, when the burst has finished. The readings are fed through the capture's
+        // meter so the frequency counter doesn't miss them, with the sampling interrupt masked (see Capture::meterBlock).
+        bool finish(Capture *meter);
+
+    private:
+        int dmaChannel = -1;
+        bool running = false;
+        uint16_t *samples = NULL;
+        uint16_t count = 0;
+        uint32_t intervalNs = 0;    // Actual interval, a whole number of ADC clocks
+        uint64_t startTime = 0;     // Time of the first reading
+};
+
+#endif
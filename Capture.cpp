@@ -17,23 +17,15 @@
 */    
 
 #include "Capture.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "Profiler.h"
 
 
-uint16_t CapturedDataStruct::getPeakSampleValue()
-{
-    if(currentSample < NUM_SAMPLES) return 0;
-    uint16_t startValue = (triggerLocation <0)? 0: triggerLocation;
-    uint16_t maxvalue = 0;
-    for(uint16_t x = startValue; x< currentSample; x++)
-    {
-        if(buffer[x] > maxvalue) maxvalue = buffer[x];
-    }
-    return maxvalue;
-}
-
-
-//alarm_pool_t * Capture::timerAlarmPool = NULL;
+alarm_pool_t * Capture::timerAlarmPool = NULL;
 bool Capture::analogInitialized = false;
+Capture *Capture::dmaCapture = NULL;
 
 Capture::Capture(uint16_t adcChannel)
 {
@@ -51,6 +43,14 @@ Capture::Capture(uint16_t adcChannel)
 Capture::~Capture()
 {
     cancel_repeating_timer(&sampling_timer);
+    if(dmaChannel >= 0)
+    {
+        dma_channel_set_irq0_enabled(dmaChannel, false);
+        dma_channel_abort(dmaChannel);
+        dma_channel_unclaim(dmaChannel);
+        adc_run(false);
+        dmaCapture = NULL;
+    }
 }
 
 
@@ -59,6 +59,11 @@ bool Capture::staticTimerCallback(struct repeating_timer *t)
     return(((Capture *)t->user_data)->timerCallback(t));
 }
 
+void Capture::staticDmaHandler()
+{
+    if(dmaCapture) dmaCapture->dmaCallback();
+}
+
 
 uint16_t Capture::getPeakVoltage()
 {
@@ -67,37 +72,38 @@ uint16_t Capture::getPeakVoltage()
     return result;
 }
 
-uint16_t Capture::getFrequency()
+FrequencyMeasurement Capture::getFrequency()
 {
-    return currentFrequency;
+    // The reciprocal counter is updated from the sampling interrupt
+    uint32_t interruptState = save_and_disable_interrupts();
+    FrequencyMeasurement result = reciprocal.getMeasurement(time_us_64());
+    restore_interrupts(interruptState);
+    if(result.cycles > 0) return result;
+
+    // No periods to time - fall back to the gated count, which is good to one count per gate
+    result.milliHertz = currentFrequency * 1000;
+    result.resolutionMilliHertz = 1000000000ULL / lastGateTime;
+    result.cycles = (uint64_t)currentFrequency * lastGateTime / 1000000;
+    return result;
 }
 
-bool Capture::timerCallback(struct repeating_timer *t)
+// Track peak, low and rising crossings for one sample. A crossing is counted for the frequency gate
+// and timestamped for the reciprocal counter. tickUs is the timestamp resolution.
+void Capture::updateMeter(uint16_t currentADC, uint64_t sampleTime, uint32_t tickUs)
 {
-    uint64_t currentTime = time_us_64();
-    uint16_t currentADC = adc_read()>>2;    // We'll only use 10 bits
     // Keep track of the peak voltage since the last voltage request
     if(currentADC > peakADCSinceLastRequest) peakADCSinceLastRequest = currentADC;
     if(currentADC < lowADCforPeriod) lowADCforPeriod = currentADC;
-    if(searchingForZero)
-    { 
-        if(currentADC < baseline){    // Below baseline (default 0.05V - allowing for rounding the lowest 10 count/ 0.05V to ground)
-            searchingForZero = false;
-        }
-    }
-    else
-    {
-        if(currentADC > baseline + 30)    // Must be about 0.1V above baseline (20 counts = 0.1V)
-        {
-            frequencyCyclesCounted++;
-            searchingForZero = true;
-            // First trigger when capturing
-            if(captureInProgress && currentCaptureBuffer->triggerLocation<0) currentCaptureBuffer->triggerLocation = currentCaptureBuffer->currentSample;
-        }
-    }
+    if(!detector.sample(currentADC)) return;
+    frequencyCyclesCounted++;
+    reciprocal.crossing(sampleTime, tickUs);
+}
 
+void Capture::updateGates(uint64_t currentTime)
+{
     if(currentTime > tenthOfSecondSamplingEndTime)
     {
+        PROFILE_REGION(baselineUpdate);
        // This logic tracks the minimum voltage over the past 10 sampling periods and considers that the baseline for frequency counting. This means it
         // can take up to a second to readjust if the lowest signal voltage rises. But it will respond quickly if the lowest voltage drops
         // We do not adjust the baselines if capturing
@@ -108,7 +114,7 @@ bool Capture::timerCallback(struct repeating_timer *t)
             baselines[seg] = baselines[seg+1];
         }
         baselines[9] = lowADCforPeriod;
-        baseline = minValue + 20; // Baseline is about .1 V over the lowest detected value;
+        detector.baseline = minValue + 20; // Baseline is about .1 V over the lowest detected value;
         lowADCforPeriod = 512;
         tenthOfSecondSamplingEndTime = currentTime + 100000;
     }
@@ -116,10 +122,13 @@ bool Capture::timerCallback(struct repeating_timer *t)
     // Has freq sampling time passed?
     if(currentTime > frequencySamplingEndTime)
     {
+        PROFILE_REGION(frequencyGate);
         if(frequencyCyclesCounted == 0 && fullSecondSample)
         {
             currentFrequency = 0;
             fullSecondSample = false;
+            frequencySamplingStartTime = currentTime;
+            frequencySamplingEndTime = currentTime + 100000;
         }
         else if(frequencyCyclesCounted < 1000 && !fullSecondSample)
         {
@@ -128,35 +137,182 @@ bool Capture::timerCallback(struct repeating_timer *t)
         }
         else 
         {
-            currentFrequency = (fullSecondSample)? frequencyCyclesCounted: frequencyCyclesCounted * 10;
+            // Use the actual gate time - a DMA capture may have held the gate open past its nominal end
+            uint64_t gateTime = currentTime - frequencySamplingStartTime;
+            currentFrequency = (frequencyCyclesCounted * 1000000ULL + gateTime/2) / gateTime;
+            lastGateTime = gateTime;
+            frequencySamplingStartTime = currentTime;
             frequencySamplingEndTime = currentTime + 100000;
             fullSecondSample = false;
             frequencyCyclesCounted = 0;
         }
     }
+}
+
+void Capture::completeCapture()
+{
+    captureInProgress = false;
+    currentCaptureBuffer->endFrequency = currentFrequency;
+    currentCaptureBuffer->captureComplete = true;
+}
+
+// How late this tick is. The timer schedules each tick from the previous target rather than from when the
+// callback ran, so after a stall (I2C or USB holding off interrupts) the missed ticks arrive late, back to back.
+// If the timer has fallen so far behind that it can't be the same schedule, start again from this tick.
+uint32_t Capture::tickLateness(uint64_t currentTime)
+{
+    uint64_t expected = nextTickTime;
+    nextTickTime += SAMPLE_RATE_US;
+    if(currentTime <= expected) return 0;
+    uint64_t lateness = currentTime - expected;
+    if(lateness > 1000 * SAMPLE_RATE_US) nextTickTime = currentTime + SAMPLE_RATE_US;
+    return (lateness > UINT32_MAX)? UINT32_MAX: lateness;
+}
+
+bool Capture::timerCallback(struct repeating_timer *t)
+{
+    PROFILE_REGION(samplingIsr);
+    uint64_t currentTime = time_us_64();
+    uint32_t lateness = tickLateness(currentTime);
+    // While the DMA engine owns the ADC the meter is updated from its block when it completes.
+    // The gates wait as well so the cycles in that block are counted in the right gate.
+    if(dmaActive) return true;
+    if(adcLent)
+    {
+        updateGates(currentTime);
+        return true;
+    }
+    uint16_t currentADC = adc_read()>>2;    // We'll only use 10 bits
+    updateMeter(currentADC, currentTime, SAMPLE_RATE_US);
+    updateGates(currentTime);
+
+    RollQueue *roll = rollQueue;
+    if(roll)
+    {
+        decimator.add(currentADC);
+        if(--currentDividerCount > 0) return true;
+        currentDividerCount = rollDivisor;
+        RollSample sample;
+        sample.value = decimator.take(rollMode, currentADC, sample.low);
+        roll->push(sample);
+        return true;
+    }
+
     if(!captureInProgress || !currentCaptureBuffer) return true; // No capturing or buffer not defined
+    decimator.add(currentADC);
     currentDividerCount-=1;
     if(currentDividerCount > 0) return true;
     currentDividerCount = currentCaptureBuffer->divisor;
-    if(currentCaptureBuffer->currentSample < sizeof(currentCaptureBuffer->buffer))
+    currentCaptureBuffer->recordLateness(lateness);
+    uint16_t low;
+    uint16_t value = decimator.take(currentCaptureBuffer->acquireMode, currentADC, low);
+    // Falling triggers watch the lows so peak detect glitches can trigger either way
+    bool crossing = trigger.sample((currentCaptureBuffer->trigger.slope == triggerFalling)? low: value) && holdoffOver(currentTime);
+    bool triggered = currentCaptureBuffer->triggerLocation >= 0;
+    bool complete = currentCaptureBuffer->addSample(value, low, crossing, trigger.getFraction());
+    if(!triggered && currentCaptureBuffer->triggerLocation >= 0) lastTriggerTime = currentTime;
+    if(complete) completeCapture();
+    return true;    // On to next cycle
+}
+
+// Feed a block of raw ADC samples taken by someone else through the meter
+void Capture::meterSamples(const uint16_t *samples, uint16_t count, uint64_t startTime, uint32_t intervalNs)
+{
+    uint32_t tickUs = (intervalNs + 999) / 1000;
+    for(uint16_t x = 0; x < count; x++)
     {
-        currentCaptureBuffer->buffer[currentCaptureBuffer->currentSample++] = currentADC;
-        if( (currentCaptureBuffer->triggerLocation>=0 && (currentCaptureBuffer->currentSample - currentCaptureBuffer->triggerLocation) > NUM_SAMPLES+1) ||
-            (currentCaptureBuffer->triggerLocation==-1 && currentCaptureBuffer->currentSample >= NUM_SAMPLES) )
+        updateMeter(samples[x]>>2, startTime + (uint64_t)x * intervalNs / 1000, tickUs);
+    }
+}
+
+// updateGates resets the gate counts and the low from the sampling interrupt, so it must not land in the middle
+// of updateMeter. Masking interrupts for a chunk at a time keeps the timer from waiting for the whole block.
+void Capture::meterBlock(const uint16_t *samples, uint16_t count, uint64_t startTime, uint32_t intervalNs)
+{
+    uint32_t tickUs = (intervalNs + 999) / 1000;
+    for(uint16_t first = 0; first < count; first += METER_BLOCK_CHUNK)
+    {
+        uint16_t end = (count - first > METER_BLOCK_CHUNK)? first + METER_BLOCK_CHUNK: count;
+        uint32_t interruptState = save_and_disable_interrupts();
+        for(uint16_t x = first; x < end; x++)
         {
-            // We have NUM_SAMPLES valid samples past the trigger, we're done
-            // Or we've captured NUM_SAMPLES DC (trigger not found)
-            captureInProgress = false;
-            currentCaptureBuffer->endFrequency = currentFrequency;
-            currentCaptureBuffer->captureComplete = true;
-            return true;
+            updateMeter(samples[x]>>2, startTime + (uint64_t)x * intervalNs / 1000, tickUs);
         }
-        return true;    // On to next cycle
+        restore_interrupts(interruptState);
     }
-    // This shouldn't ever happen, but just in case, let's not overflow the buffer.
-    captureInProgress = false;
-    currentCaptureBuffer->endFrequency = currentFrequency;
-    currentCaptureBuffer->captureComplete = true;
+}
+
+// Run the ADC free-running at the requested interval and let DMA move the FIFO into the capture buffer
+bool Capture::startDmaCapture(CapturedDataStruct *cds)
+{
+    if(dmaChannel < 0)
+    {
+        dmaChannel = dma_claim_unused_channel(false);
+        if(dmaChannel < 0) return false;
+        dmaCapture = this;
+        dma_channel_set_irq0_enabled(dmaChannel, true);
+        irq_set_exclusive_handler(DMA_IRQ_0, staticDmaHandler);
+        irq_set_enabled(DMA_IRQ_0, true);
+    }
+    dma_channel_config cfg = dma_channel_get_default_config(dmaChannel);
+    channel_config_set_transfer_data_size(&cfg, DMA_SIZE_16);
+    channel_config_set_read_increment(&cfg, false);
+    channel_config_set_write_increment(&cfg, true);
+    channel_config_set_dreq(&cfg, DREQ_ADC);
+
+    uint32_t interval = cds->sampleIntervalNs;
+    if(interval < DMA_MIN_SAMPLE_INTERVAL_NS) interval = DMA_MIN_SAMPLE_INTERVAL_NS;
+    uint32_t adcClocks = (uint64_t)interval * (ADC_CLOCK_HZ / 1000000) / 1000;
+
+    dmaActive = true;
+    adc_fifo_setup(true, true, 1, false, false);
+    adc_set_clkdiv(adcClocks - 1);     // A conversion starts every (1 + div) ADC clocks
+    adc_fifo_drain();
+    dma_channel_configure(dmaChannel, &cfg, cds->buffer, &adc_hw->fifo, CAPTURE_BUFFER_SIZE, true);
+    dmaIntervalNs = adcClocks * 1000 / (ADC_CLOCK_HZ / 1000000);
+    dmaStartTime = time_us_64();
+    adc_run(true);
+    return true;
+}
+
+void Capture::dmaCallback()
+{
+    PROFILE_REGION(dmaIsr);
+    dma_channel_acknowledge_irq0(dmaChannel);
+    adc_run(false);
+    adc_fifo_setup(false, false, 0, false, false);
+    adc_fifo_drain();
+    adc_set_clkdiv(0);
+
+    // Feed the block through the meter and find the trigger
+    CapturedDataStruct *cds = currentCaptureBuffer;
+    uint32_t tickUs = (dmaIntervalNs + 999) / 1000;
+    for(uint16_t x = 0; x < CAPTURE_BUFFER_SIZE; x++)
+    {
+        uint16_t currentADC = cds->buffer[x]>>2;    // We'll only use 10 bits
+        cds->buffer[x] = currentADC;
+        uint64_t sampleTime = dmaStartTime + (uint64_t)x * dmaIntervalNs / 1000;
+        updateMeter(currentADC, sampleTime, tickUs);
+        if(trigger.sample(currentADC) && holdoffOver(sampleTime) && cds->triggerLocation < 0)
+        {
+            cds->addBlockCrossing(x, trigger.getFraction());
+            if(cds->triggerLocation >= 0) lastTriggerTime = sampleTime;
+        }
+    }
+    cds->currentSample = CAPTURE_BUFFER_SIZE;
+    dmaActive = false;
+    completeCapture();
+}
+
+bool Capture::startRoll(RollQueue *queue, uint16_t divisor, AcquireMode mode)
+{
+    if(captureInProgress) return false;
+    stopRoll();
+    rollDivisor = (divisor == 0)? 1: divisor;
+    rollMode = mode;
+    currentDividerCount = rollDivisor;
+    decimator.reset();
+    rollQueue = queue;      // Last - the timer starts rolling as soon as this is set
     return true;
 }
 
@@ -168,15 +324,22 @@ bool Capture::startCapture(CapturedDataStruct *cds)
     if(cds != NULL)
     {
         currentDividerCount = cds->divisor;
-        cds->currentSample = 0;
-        cds->triggerLocation = -1;
+        trigger.begin(cds->trigger, detector.baseline + TRIGGER_AUTO_OFFSET);
+        decimator.reset();
+        cds->reset();
         captureInProgress = true;
+        // Peak detect and average need every reading, so they stay on the timer engine.
+        // If no DMA channel is available the timer engine captures using the divisor.
+        if(cds->sampleIntervalNs <= DMA_MAX_SAMPLE_INTERVAL_NS && cds->acquireMode == acquireSample) startDmaCapture(cds);
     }
     if(!timerOn)
     {
         timerOn = true;
         //memset(&sampling_timer, 0, sizeof(sampling_timer)); // Clear the existing structure
-        if (!  add_repeating_timer_us(-SAMPLE_RATE_US, staticTimerCallback, this, &sampling_timer)) {
+        // The default alarm pool interrupts core0. Create our own so the timer interrupts the core running the capture.
+        if(!timerAlarmPool) timerAlarmPool = alarm_pool_create_with_unused_hardware_alarm(4);
+        nextTickTime = time_us_64() + SAMPLE_RATE_US;
+        if (!timerAlarmPool || !alarm_pool_add_repeating_timer_us(timerAlarmPool, -SAMPLE_RATE_US, staticTimerCallback, this, &sampling_timer)) {
             printf("Failed to start ADC sampling timer!");
             captureInProgress = false;
             return false;
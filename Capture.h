@@ -23,20 +23,14 @@
 #include "pico/stdlib.h"
 #include "hardware/timer.h"
 #include "hardware/adc.h"
+#include "CaptureBuffer.h"
+#include "ReciprocalCounter.h"
+#include "Roll.h"
 
-#define NUM_SAMPLES 100
-#define SAMPLE_RATE_US 25
-
-typedef struct CapturedDataStruct
-{
-    uint16_t divisor = 1;   // # of SAMPLE_RATE_US events for each data point captured
-    uint16_t buffer [ NUM_SAMPLES * 2 ] = {};    // The sample buffer
-    int16_t triggerLocation = -1;   // Location of triggered data (0 - NUM_SAMPLES-1)
-    uint16_t currentSample = 0;     // Location for next sampled data
-    uint16_t endFrequency = 0;      // Frequency captured at the end of the frame
-    bool captureComplete = false;   // Set to true when capture is complete
-    uint16_t getPeakSampleValue();
-} CapturedData;
+#define ADC_CLOCK_HZ 48000000
+#define DMA_MIN_SAMPLE_INTERVAL_NS 2000      // The ADC takes 96 clocks per conversion: 500 kS/s
+#define DMA_MAX_SAMPLE_INTERVAL_NS 1365000   // Largest interval the ADC clock divider can produce
+#define METER_BLOCK_CHUNK 32                 // Readings metered per masked stretch, so the sampling timer is held off about a tick
 
 class Capture
 {
@@ -52,26 +46,68 @@ class Capture
 
         uint16_t getPeakVoltage();
 
-        uint16_t getFrequency();
+        // Reciprocal reading when the signal has crossings, otherwise the gated count
+        FrequencyMeasurement getFrequency();
 
         bool getTimerOn() { return timerOn; }
 
+        // While the ADC is lent to the streamer the timer leaves it alone and the meter is fed from the
+        // streamed blocks instead. Only lend it when no capture is in progress.
+        void lendAdc(bool lent) { adcLent = lent; }
+        // Feed a block of raw readings through the meter from an interrupt handler, which the sampling timer can't preempt
+        void meterSamples(const uint16_t *samples, uint16_t count, uint64_t startTime, uint32_t intervalNs);
+        // The same from thread mode. The sampling timer still runs the gates while the ADC is lent, so the block
+        // is fed with interrupts masked, a few readings at a time.
+        void meterBlock(const uint16_t *samples, uint16_t count, uint64_t startTime, uint32_t intervalNs);
+
         static bool staticTimerCallback(struct repeating_timer *t);
 
+        static void staticDmaHandler();
+
         // Returns true on success, false on failure. buffer must be large enough to hold # of samples from constructor
-        // The divider specifies to skip that number of entries to capture lower frequencies
+        // If the sampleIntervalNs fits the ADC clock divider the capture runs free-running into the ADC FIFO and is moved by DMA.
+        // Otherwise the divider specifies to skip that number of entries to capture lower frequencies
         // For example: With the default 25us clock, it's 40Khz, 4 = 10khz, 40 = 1khz, 400 = 100hz, 4000 = 10hz
+        // In peak detect and average modes the skipped entries are reduced into each sample instead (see Decimator).
         bool startCapture(CapturedDataStruct *cds);
 
-        //static alarm_pool_t * timerAlarmPool;
+        // Roll mode: take a sample every divisor timer ticks, reduced as mode says, and push each one to queue
+        // as it is taken. Samples the queue has no room for are dropped. Returns false if a capture is in progress.
+        bool startRoll(RollQueue *queue, uint16_t divisor, AcquireMode mode);
+        void stopRoll() { rollQueue = NULL; }
+        bool isRolling() { return rollQueue != NULL; }
+
+        static alarm_pool_t * timerAlarmPool;    // Alarm pool for the sampling timer, created on the core that starts it
 
     private:
         static bool analogInitialized;
+        static Capture *dmaCapture;     // Capture that owns the DMA interrupt
+
+        uint32_t tickLateness(uint64_t currentTime);
+        void updateMeter(uint16_t currentADC, uint64_t sampleTime, uint32_t tickUs);
+        inline bool holdoffOver(uint64_t time) { return time - lastTriggerTime >= currentCaptureBuffer->trigger.holdoffUs; }
+        void updateGates(uint64_t currentTime);
+        void completeCapture();
+
+        bool startDmaCapture(CapturedDataStruct *cds);
+        void dmaCallback();
+
+        int dmaChannel = -1;
+        volatile bool dmaActive = false;    // ADC is free-running into the FIFO; the timer must not touch it
+        volatile bool adcLent = false;      // The streamer owns the ADC
+        uint64_t dmaStartTime = 0;          // Time the DMA block started, for timestamping its samples
+        uint32_t dmaIntervalNs = 0;         // Sample interval of the DMA block
 
         CapturedDataStruct *currentCaptureBuffer;
 
         uint16_t m_adcChannel = 0;
         uint16_t currentDividerCount;
+        TriggerDetector trigger;                // Watches the stored samples for the capture's trigger
+        uint64_t lastTriggerTime = 0;           // When the previous frame triggered, for the holdoff
+        Decimator decimator;                    // Readings since the last stored sample
+        RollQueue * volatile rollQueue = NULL;  // Where roll samples go, NULL when not rolling
+        uint16_t rollDivisor = 1;
+        AcquireMode rollMode = acquireSample;
 
         uint64_t frequencySamplingStartTime = 0;
         uint64_t frequencySamplingEndTime = 0;
@@ -80,14 +116,16 @@ class Capture
         uint16_t peakADCSinceLastRequest = 0;
         bool    fullSecondSample = false;   // fullSecondSample is true if sampling frequency over an entire second
 
-        uint32_t currentFrequency = 0;  // 10X the frequency (to allow one decimal digit without floating point math)
-        bool searchingForZero = false;  // Looking for zero. True means we are at zero.
+        uint32_t currentFrequency = 0;
+        uint32_t lastGateTime = 100000;     // Length of the gate that produced currentFrequency
+        ReciprocalCounter reciprocal;       // Period timestamp frequency measurement
 
         uint16_t baselines[10];     // Lowest ADC value in the last 10 1/10 second periods.
-        uint16_t baseline = 20;     // Current baseline value for frequency counting
+        CrossingDetector detector;  // Rising crossing detector for frequency counting and triggering
         uint16_t lowADCforPeriod = 512;
 
         bool timerOn = false;
+        uint64_t nextTickTime = 0;  // When the sampling timer should fire next
         struct repeating_timer sampling_timer = {};  
 
 };
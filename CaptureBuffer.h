@@ -0,0 +1,272 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __CAPTUREBUFFER_H__
+#define __CAPTUREBUFFER_H__
+
+// Sample buffer and trigger logic shared by the timer and DMA capture engines.
+// host/CaptureBufferTest.cpp runs it against synthetic sample streams, and host/DecimatorTest.cpp checks the Decimator.
+
+#include <stdint.h>
+#include "Trigger.h"
+
+#define NUM_SAMPLES 100
+#define CAPTURE_BUFFER_SIZE (NUM_SAMPLES * 2)
+#define SAMPLE_RATE_US 25
+#define SAMPLE_LATE_US 5            // A timer tick this much behind schedule has moved its sample noticeably
+#define DECIMATE_MIN_DIVISOR 4      // Peak detect and average take intervals of this many timer ticks and up
+
+// What is stored for each sample when the timer engine takes more than one reading per sample
+enum AcquireMode : uint8_t
+{
+    acquireSample = 0,      // The last reading - the others are skipped
+    acquirePeak,            // The highest and lowest readings, so short glitches are still seen
+    acquireAverage          // The mean of the readings, which filters noise that would otherwise alias
+};
+
+// Accumulates the readings between stored samples. Cheap enough for every sampling tick.
+typedef struct DecimatorStruct
+{
+    uint16_t low = UINT16_MAX;
+    uint16_t high = 0;
+    uint32_t sum = 0;
+    uint16_t count = 0;
+
+    inline void add(uint16_t value)
+    {
+        if(value < low) low = value;
+        if(value > high) high = value;
+        sum += value;
+        count++;
+    }
+
+    // The value to store for mode, and in peak mode the low one. latest is the reading just added.
+    // Starts the next interval.
+    inline uint16_t take(AcquireMode mode, uint16_t latest, uint16_t &lowValue)
+    {
+        uint16_t value = latest;
+        lowValue = latest;
+        if(count > 0 && mode == acquirePeak)
+        {
+            value = high;
+            lowValue = low;
+        }
+        else if(count > 0 && mode == acquireAverage)
+        {
+            value = (sum + count / 2) / count;
+            lowValue = value;
+        }
+        reset();
+        return value;
+    }
+
+    inline void reset()
+    {
+        low = UINT16_MAX;
+        high = 0;
+        sum = 0;
+        count = 0;
+    }
+} Decimator;
+
+// Rising edge detector used by the frequency counter.
+// A crossing is reported when the signal rises 30 counts above the baseline after having dropped below it.
+typedef struct CrossingDetectorStruct
+{
+    uint16_t baseline = 20;         // Current baseline value (default 0.05V - allowing for rounding the lowest 10 count/ 0.05V to ground)
+    bool searchingForZero = false;  // Looking for zero. True means we are at zero.
+
+    // Returns true if this sample is a rising crossing
+    inline bool sample(uint16_t currentADC)
+    {
+        if(searchingForZero)
+        {
+            if(currentADC < baseline) searchingForZero = false;
+            return false;
+        }
+        if(currentADC > baseline + 30)    // Must be about 0.1V above baseline (20 counts = 0.1V)
+        {
+            searchingForZero = true;
+            return true;
+        }
+        return false;
+    }
+} CrossingDetector;
+
+typedef struct CapturedDataStruct
+{
+    uint16_t divisor = 1;   // # of SAMPLE_RATE_US events for each data point captured (timer engine)
+    uint32_t sequence = 0;  // Frame number, assigned when the capture is requested
+    uint32_t sampleIntervalNs = SAMPLE_RATE_US * 1000;  // Time between samples. The DMA engine sets the ADC clock from this.
+    uint8_t preTriggerPercent = 0;  // Portion of the displayed samples that come before the trigger (0 - 100)
+    bool circular = false;          // Timer engine samples continuously into a ring buffer until triggered
+    AcquireMode acquireMode = acquireSample;    // How the timer engine reduces the readings to samples. DMA captures are acquireSample.
+    TriggerSettings trigger;        // What starts the displayed part of the capture
+    uint16_t buffer [ CAPTURE_BUFFER_SIZE ] = {};    // The sample buffer. The highs in peak detect mode.
+    uint16_t lowBuffer [ CAPTURE_BUFFER_SIZE ] = {}; // The lows in peak detect mode
+    int16_t triggerLocation = -1;   // Location of triggered data in the buffer
+    uint8_t triggerFraction = 0;    // The level was crossed this many 256ths of a sample after the sample before triggerLocation
+    uint16_t startLocation = 0;     // Location of the first displayed sample. Display wraps at the end of the buffer.
+    uint16_t currentSample = 0;     // Location for next sampled data
+    uint16_t samplesTaken = 0;      // Number of samples since the capture started (circular mode)
+    uint16_t postTriggerRemaining = 0;  // Samples still to take after the trigger (circular mode)
+    uint32_t endFrequency = 0;      // Frequency captured at the end of the frame
+    uint32_t maxLatenessUs = 0;     // Worst lateness of a timer tick that stored a sample (timer engine)
+    uint16_t lateTicks = 0;         // Samples taken more than SAMPLE_LATE_US behind schedule
+    uint16_t missedTicks = 0;       // Samples taken a whole timer period or more behind schedule
+    bool captureComplete = false;   // Set to true when capture is complete
+    uint16_t getPeakSampleValue();
+
+    // Number of displayed samples that precede the trigger
+    inline uint16_t preTriggerSamples()
+    {
+        uint16_t percent = (preTriggerPercent > 100)? 100: preTriggerPercent;
+        return percent * (NUM_SAMPLES-1) / 100;
+    }
+
+    // Displayed sample x (0 - NUM_SAMPLES-1), read in place from the buffer
+    inline uint16_t sampleAt(uint16_t x)
+    {
+        uint16_t location = startLocation + x;
+        if(location >= CAPTURE_BUFFER_SIZE) location -= CAPTURE_BUFFER_SIZE;
+        return buffer[location];
+    }
+
+    // Displayed sample x interpolated back by the trigger's sub-sample position, so the trigger level lands
+    // on the trigger column on every frame rather than anywhere within a sample of it
+    inline uint16_t alignedSampleAt(uint16_t x)
+    {
+        if(triggerLocation < 0 || x == 0) return sampleAt(x);
+        uint32_t weight = triggerFraction;
+        return (sampleAt(x - 1) * (TRIGGER_FRACTION_ONE - weight) + sampleAt(x) * weight + TRIGGER_FRACTION_ONE / 2) / TRIGGER_FRACTION_ONE;
+    }
+
+    // Low of displayed sample x in peak detect mode, otherwise the sample
+    inline uint16_t lowAt(uint16_t x)
+    {
+        if(acquireMode != acquirePeak) return sampleAt(x);
+        uint16_t location = startLocation + x;
+        if(location >= CAPTURE_BUFFER_SIZE) location -= CAPTURE_BUFFER_SIZE;
+        return lowBuffer[location];
+    }
+
+    // Prepare the buffer for a new capture
+    inline void reset()
+    {
+        currentSample = 0;
+        samplesTaken = 0;
+        startLocation = 0;
+        triggerLocation = -1;
+        triggerFraction = 0;
+        maxLatenessUs = 0;
+        lateTicks = 0;
+        missedTicks = 0;
+    }
+
+    // Note how far behind schedule the timer tick for the next sample ran
+    inline void recordLateness(uint32_t latenessUs)
+    {
+        if(latenessUs > maxLatenessUs) maxLatenessUs = latenessUs;
+        if(latenessUs >= SAMPLE_RATE_US) missedTicks++;
+        else if(latenessUs > SAMPLE_LATE_US) lateTicks++;
+    }
+
+    // True if a sample was taken more than half a sample interval late - it is off by more than half a pixel
+    inline bool timingSuspect()
+    {
+        return maxLatenessUs * 2000 > sampleIntervalNs;
+    }
+
+    // Store the next sample, and its low in peak detect mode. crossing is true if the sample fired the trigger,
+    // fraction is where the level was crossed (see TriggerDetector).
+    // Returns true when the capture is complete - either NUM_SAMPLES valid samples around the trigger,
+    // NUM_SAMPLES of DC (trigger not found), or the buffer is full.
+    inline bool addSample(uint16_t value, uint16_t low, bool crossing, uint8_t fraction = 0)
+    {
+        if(acquireMode == acquirePeak) lowBuffer[currentSample] = low;     // Both layouts store at currentSample
+        if(circular) return addCircularSample(value, crossing, fraction);
+        uint16_t preTrigger = preTriggerSamples();
+        if(crossing && triggerLocation < 0 && currentSample >= preTrigger)
+        {
+            triggerLocation = currentSample;
+            triggerFraction = fraction;
+            startLocation = triggerLocation - preTrigger;
+        }
+        buffer[currentSample++] = value;
+        if(currentSample >= CAPTURE_BUFFER_SIZE) return true;
+        if(triggerLocation >= 0) return (currentSample - triggerLocation) > NUM_SAMPLES - preTrigger + 1;
+        return currentSample >= NUM_SAMPLES + preTrigger;
+    }
+
+    // Ring buffer capture. Sampling continues until the pre-trigger history is filled, then the capture arms.
+    // After a trigger the capture stops once the rest of the display has been sampled.
+    // If no trigger arrives within NUM_SAMPLES of arming, the last NUM_SAMPLES are shown untriggered.
+    inline bool addCircularSample(uint16_t value, bool crossing, uint8_t fraction)
+    {
+        uint16_t location = currentSample;
+        buffer[location] = value;
+        if(++currentSample >= CAPTURE_BUFFER_SIZE) currentSample = 0;
+        samplesTaken++;
+        uint16_t preTrigger = preTriggerSamples();
+        if(triggerLocation < 0)
+        {
+            if(crossing && samplesTaken > preTrigger)
+            {
+                triggerLocation = location;
+                triggerFraction = fraction;
+                startLocation = (location >= preTrigger)? location - preTrigger: location + CAPTURE_BUFFER_SIZE - preTrigger;
+                postTriggerRemaining = NUM_SAMPLES - preTrigger - 1;
+                return postTriggerRemaining == 0;
+            }
+            if(samplesTaken >= NUM_SAMPLES + preTrigger)
+            {
+                startLocation = (currentSample >= NUM_SAMPLES)? currentSample - NUM_SAMPLES: currentSample + CAPTURE_BUFFER_SIZE - NUM_SAMPLES;
+                return true;
+            }
+            return false;
+        }
+        return --postTriggerRemaining == 0;
+    }
+
+    // Note a trigger at sample x of a buffer that was filled in a single block (DMA engine).
+    // Only crossings that leave room for the pre-trigger samples before them and the rest of the display after them are accepted.
+    inline void addBlockCrossing(uint16_t x, uint8_t fraction = 0)
+    {
+        uint16_t preTrigger = preTriggerSamples();
+        if(triggerLocation < 0 && x >= preTrigger && x <= CAPTURE_BUFFER_SIZE - NUM_SAMPLES + preTrigger)
+        {
+            triggerLocation = x;
+            triggerFraction = fraction;
+            startLocation = x - preTrigger;
+        }
+    }
+} CapturedData;
+
+inline uint16_t CapturedDataStruct::getPeakSampleValue()
+{
+    if(!captureComplete) return 0;
+    uint16_t maxvalue = 0;
+    for(uint16_t x = 0; x< NUM_SAMPLES; x++)
+    {
+        uint16_t value = sampleAt(x);
+        if(value > maxvalue) maxvalue = value;
+    }
+    return maxvalue;
+}
+
+#endif
@@ -0,0 +1,185 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DEEPRECORD_H__
+#define __DEEPRECORD_H__
+
+// Deep memory record. A long run of samples is packed at 10 bits - four samples in five bytes - into a
+// statically reserved arena, and viewed through a zoom and pan window.
+// The record is exactly DEEP_RECORD_COLUMNS screen columns of 2^DEEP_MAX_SHIFT samples, and every zoom level
+// shows a power of two samples per column, so each column at every zoom is one aligned block. A min/max
+// pyramid, built as the samples arrive, has an entry for every block from DEEP_BASE_BLOCK samples up, so a
+// column is a single lookup however far out the view is zoomed. Below that the samples are read directly.
+// The pyramid keeps the top 8 bits of each value, which is more than the display can show.
+
+#include <stdint.h>
+#include "CaptureBuffer.h"
+
+#define DEEP_RECORD_COLUMNS     NUM_SAMPLES
+#define DEEP_MAX_SHIFT          10      // Zoomed all the way out a column is 1024 samples
+#define DEEP_RECORD_SAMPLES     ((uint32_t)DEEP_RECORD_COLUMNS << DEEP_MAX_SHIFT)  // 102400
+#define DEEP_RECORD_BYTES       (DEEP_RECORD_SAMPLES / 4 * 5)                      // 128000
+#define DEEP_BASE_SHIFT         5       // The pyramid starts at blocks of 32 samples
+#define DEEP_BASE_BLOCK         (1 << DEEP_BASE_SHIFT)
+#define DEEP_PYRAMID_LEVELS     (DEEP_MAX_SHIFT - DEEP_BASE_SHIFT + 1)
+#define DEEP_PYRAMID_ENTRIES    (2 * (DEEP_RECORD_SAMPLES >> DEEP_BASE_SHIFT) - (DEEP_RECORD_SAMPLES >> DEEP_MAX_SHIFT))
+#define DEEP_MAX_ZOOM           DEEP_MAX_SHIFT  // One sample per column
+
+static_assert((DEEP_RECORD_SAMPLES >> DEEP_MAX_SHIFT) % 4 == 0, "Every pyramid level must pack into whole groups");
+
+class DeepRecord
+{
+    public:
+        // Start an empty record of samples taken sampleIntervalNs apart
+        void begin(uint32_t sampleIntervalNs)
+        {
+            intervalNs = sampleIntervalNs;
+            count = 0;
+            lostSamples = 0;
+            blockLow = UINT8_MAX;
+            blockHigh = 0;
+            zoom = 0;
+            viewStart = 0;
+        }
+
+        // Add the next 10 bit sample. Ignored once the record is full.
+        inline void append(uint16_t value)
+        {
+            if(count >= DEEP_RECORD_SAMPLES) return;
+            uint8_t *group = packed + (count >> 2) * 5;
+            uint8_t slot = count & 3;
+            group[slot] = value;
+            uint8_t highBits = (value >> 8) & 3;
+            group[4] = (slot == 0)? highBits: group[4] | (highBits << (slot * 2));
+            uint8_t reduced = value >> 2;
+            if(reduced < blockLow) blockLow = reduced;
+            if(reduced > blockHigh) blockHigh = reduced;
+            count++;
+            if((count & (DEEP_BASE_BLOCK - 1)) == 0) closeBlock();
+        }
+
+        // Samples that should have been recorded but weren't, so the record has gaps
+        void addLost(uint32_t samples) { lostSamples += samples; }
+
+        inline uint16_t sampleAt(uint32_t index)
+        {
+            const uint8_t *group = packed + (index >> 2) * 5;
+            uint8_t slot = index & 3;
+            return group[slot] | (((group[4] >> (slot * 2)) & 3) << 8);
+        }
+
+        // Lowest and highest value in the column of the view at x. Returns false past the end of the record.
+        bool column(uint16_t x, uint16_t &low, uint16_t &high)
+        {
+            uint8_t shift = getShift();
+            uint32_t start = viewStart + ((uint32_t)x << shift);
+            if(x >= DEEP_RECORD_COLUMNS || start + (1 << shift) > count) return false;
+            if(shift >= DEEP_BASE_SHIFT)
+            {
+                uint32_t entry = levelOffset(shift - DEEP_BASE_SHIFT) + (start >> shift);
+                low = pyramidLow[entry] << 2;
+                high = (pyramidHigh[entry] << 2) | 3;
+                return true;
+            }
+            low = UINT16_MAX;
+            high = 0;
+            for(uint32_t index = start; index < start + (1 << shift); index++)
+            {
+                uint16_t value = sampleAt(index);
+                if(value < low) low = value;
+                if(value > high) high = value;
+            }
+            return true;
+        }
+
+        // Zoom in or out by a factor of two about the middle of the view
+        void setZoom(uint8_t newZoom)
+        {
+            if(newZoom > DEEP_MAX_ZOOM) newZoom = DEEP_MAX_ZOOM;
+            uint32_t middle = viewStart + ((uint32_t)DEEP_RECORD_COLUMNS << getShift()) / 2;
+            zoom = newZoom;
+            uint32_t half = ((uint32_t)DEEP_RECORD_COLUMNS << getShift()) / 2;
+            setViewStart((middle > half)? middle - half: 0);
+        }
+
+        // Move the view by a number of columns, stopping at the ends of the record
+        void pan(int32_t columns)
+        {
+            int64_t start = (int64_t)viewStart + ((int64_t)columns << getShift());
+            setViewStart((start < 0)? 0: (uint32_t)start);
+        }
+
+        bool full() { return count >= DEEP_RECORD_SAMPLES; }
+        uint32_t getCount() { return count; }
+        uint32_t getLostSamples() { return lostSamples; }
+        uint32_t getSampleIntervalNs() { return intervalNs; }
+        uint8_t getZoom() { return zoom; }
+        uint8_t getShift() { return DEEP_MAX_SHIFT - zoom; }   // The view has 2^shift samples to a column
+        uint32_t getViewStart() { return viewStart; }
+        uint32_t getViewSamples() { return (uint32_t)DEEP_RECORD_COLUMNS << getShift(); }
+        bool atEnd() { return viewStart + getViewSamples() >= DEEP_RECORD_SAMPLES; }
+
+    private:
+        // The first entry of a level. Each level has half the entries of the one below.
+        static inline uint32_t levelOffset(uint8_t level)
+        {
+            uint32_t base = DEEP_RECORD_SAMPLES >> DEEP_BASE_SHIFT;
+            return 2 * base - 2 * (base >> level);
+        }
+
+        // A base block is complete. Each entry that completes a pair completes the entry above it.
+        void closeBlock()
+        {
+            uint32_t index = (count >> DEEP_BASE_SHIFT) - 1;
+            uint8_t low = blockLow;
+            uint8_t high = blockHigh;
+            for(uint8_t level = 0; level < DEEP_PYRAMID_LEVELS; level++)
+            {
+                uint32_t entry = levelOffset(level) + index;
+                pyramidLow[entry] = low;
+                pyramidHigh[entry] = high;
+                if((index & 1) == 0) break;
+                if(pyramidLow[entry - 1] < low) low = pyramidLow[entry - 1];
+                if(pyramidHigh[entry - 1] > high) high = pyramidHigh[entry - 1];
+                index >>= 1;
+            }
+            blockLow = UINT8_MAX;
+            blockHigh = 0;
+        }
+
+        // Columns are aligned blocks, and the view stays inside the record
+        void setViewStart(uint32_t start)
+        {
+            uint32_t last = DEEP_RECORD_SAMPLES - getViewSamples();
+            if(start > last) start = last;
+            viewStart = start >> getShift() << getShift();
+        }
+
+        uint8_t packed[DEEP_RECORD_BYTES];          // Four samples to five bytes: the low bytes, then their top two bits
+        uint8_t pyramidLow[DEEP_PYRAMID_ENTRIES];   // Top 8 bits of the lowest and highest sample of each block
+        uint8_t pyramidHigh[DEEP_PYRAMID_ENTRIES];
+        uint32_t intervalNs = 0;
+        uint32_t count = 0;
+        uint32_t lostSamples = 0;
+        uint8_t blockLow = UINT8_MAX;               // Base block being recorded
+        uint8_t blockHigh = 0;
+        uint8_t zoom = 0;                           // 0 shows the whole record
+        uint32_t viewStart = 0;                     // First sample in the view
+};
+
+#endif
@@ -0,0 +1,82 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "EdgeCounter.h"
+#include "hardware/pwm.h"
+
+EdgeCounter::EdgeCounter(uint pin)
+{
+    m_pin = pin;
+}
+
+EdgeCounter::~EdgeCounter()
+{
+    if(!started) return;
+    cancel_repeating_timer(&gate_timer);
+    pwm_set_enabled(slice, false);
+}
+
+bool EdgeCounter::staticTimerCallback(struct repeating_timer *t)
+{
+    return(((EdgeCounter *)t->user_data)->timerCallback(t));
+}
+
+bool EdgeCounter::start(alarm_pool_t *pool)
+{
+    if(started) return true;
+
+    // The slice counter advances on each rising edge of the B pin and wraps at 65535
+    gpio_set_function(m_pin, GPIO_FUNC_PWM);
+    gpio_pull_down(m_pin);     // Counts nothing rather than noise on a board without the counter wire
+    slice = pwm_gpio_to_slice_num(m_pin);
+    pwm_config cfg = pwm_get_default_config();
+    pwm_config_set_clkdiv_mode(&cfg, PWM_DIV_B_RISING);
+    pwm_config_set_clkdiv(&cfg, 1);
+    pwm_init(slice, &cfg, false);
+    pwm_set_counter(slice, 0);
+    pwm_set_enabled(slice, true);
+
+    lastCount = 0;
+    edgesCounted = 0;
+    gateStartTime = time_us_64();
+    if(!alarm_pool_add_repeating_timer_us(pool, -EDGE_READ_US, staticTimerCallback, this, &gate_timer))
+    {
+        printf("Failed to start edge counter timer!");
+        pwm_set_enabled(slice, false);
+        return false;
+    }
+    started = true;
+    return true;
+}
+
+bool EdgeCounter::timerCallback(struct repeating_timer *t)
+{
+    uint16_t count = pwm_get_counter(slice);
+    edgesCounted += (uint16_t)(count - lastCount);  // Modulo arithmetic handles the counter wrapping
+    lastCount = count;
+
+    uint64_t currentTime = time_us_64();
+    uint64_t gateTime = currentTime - gateStartTime;
+    if(gateTime >= EDGE_GATE_US)
+    {
+        currentFrequency = (edgesCounted * 1000000ULL + gateTime/2) / gateTime;
+        edgesCounted = 0;
+        gateStartTime = currentTime;
+    }
+    return true;
+}
@@ -0,0 +1,63 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __EDGECOUNTER_H__
+#define __EDGECOUNTER_H__
+
+// Hardware frequency counter. A PWM slice in B-pin rising edge mode counts input edges with no CPU
+// involvement, and a gate timer reads the counter. This works well into the MHz range, but only for
+// signals that swing through the GPIO logic thresholds. The software counter in Capture handles small signals.
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/timer.h"
+
+// The conditioned input must also be wired to this pin - a change to the board (see the README).
+// It has to be a PWM B channel (odd GPIO).
+#define FREQ_COUNTER_PIN 27
+#define EDGE_READ_US    10000   // Counter read interval. The 16 bit counter must not wrap between reads (6.5 MHz max)
+#define EDGE_GATE_US    100000  // Frequency gate time
+
+class EdgeCounter
+{
+    public:
+        EdgeCounter(uint pin);
+        ~EdgeCounter();
+
+        // Start counting. The gate timer runs on the given alarm pool.
+        bool start(alarm_pool_t *pool);
+
+        uint32_t getFrequency() { return currentFrequency; }
+
+        bool timerCallback(struct repeating_timer *t);
+        static bool staticTimerCallback(struct repeating_timer *t);
+
+    private:
+        uint m_pin;
+        uint slice = 0;
+        bool started = false;
+
+        uint16_t lastCount = 0;         // Counter value at the previous read
+        uint32_t edgesCounted = 0;      // Edges counted in the current gate
+        uint64_t gateStartTime = 0;
+        uint32_t currentFrequency = 0;
+
+        struct repeating_timer gate_timer = {};
+};
+
+#endif
@@ -0,0 +1,235 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __EQUIVALENTTIME_H__
+#define __EQUIVALENTTIME_H__
+
+// Equivalent time sampling for repetitive signals too fast to show in real time.
+// Every sample of a capture is placed by its phase within the measured period, so a capture that spans
+// many periods fills in one period at a far finer resolution than the sample interval. The sample
+// interval is chosen so successive samples step through the period at offsets that reach every phase
+// bin, and each capture is aligned on the point where its folded waveform rises through the middle,
+// so captures started at any point in the signal add up. Older captures fade out.
+// Phases are kept in 1/65536ths of an ADC clock, which is exact for whole-clock sample intervals.
+
+#include <stdint.h>
+#include "CaptureBuffer.h"
+
+#define ETS_MIN_FREQUENCY   20000       // Below this the timebase shows enough periods in real time
+#define ETS_MAX_FREQUENCY   4000000     // Keeps the frequency in mHz within 32 bits
+#define ETS_RESTART_DIVISOR 200         // Start over when the frequency moves by more than 1/200th
+#define ETS_PERIODS         2           // Periods across the reconstructed trace
+#define ETS_BINS            (NUM_SAMPLES / ETS_PERIODS)     // Phase bins in a period
+#define ETS_CAPTURES        4           // Captures held before the older ones fade
+#define ETS_MIN_CLOCKS      96          // Fastest ADC conversion
+#define ETS_CLOCK_CHOICES   96          // Sample intervals tried for the best phase coverage
+#define ETS_MIN_SWING       8           // Folded waveforms flatter than this (in counts) have nothing to align on
+#define ETS_FRACTION_BITS   16
+
+class EquivalentTime
+{
+    public:
+        // Start over for a signal of frequencyMilliHz. Returns the sample interval to capture at, in ADC clocks.
+        uint32_t begin(uint32_t frequencyMilliHz, uint32_t adcClockHz)
+        {
+            clear();
+            milliHertz = frequencyMilliHz;
+            uint64_t period = ((uint64_t)adcClockHz * 1000 << ETS_FRACTION_BITS) / frequencyMilliHz;
+            periodQ = (period > UINT32_MAX)? UINT32_MAX: period;
+            binQ = periodQ / ETS_BINS;
+
+            // Pick the interval that spreads one capture's samples most evenly over the bins
+            uint16_t bestMinimum = 0;
+            uint16_t bestCovered = 0;
+            intervalClocks = ETS_MIN_CLOCKS;
+            for(uint32_t clocks = ETS_MIN_CLOCKS; clocks < ETS_MIN_CLOCKS + ETS_CLOCK_CHOICES; clocks++)
+            {
+                uint16_t hits[ETS_BINS] = {};
+                uint32_t step = ((uint32_t)clocks << ETS_FRACTION_BITS) % periodQ;
+                uint32_t phase = 0;
+                for(uint16_t sample = 0; sample < CAPTURE_BUFFER_SIZE; sample++)
+                {
+                    hits[binOf(phase)]++;
+                    phase = advance(phase, step);
+                }
+                uint16_t covered = 0;
+                uint16_t minimum = UINT16_MAX;
+                for(uint16_t bin = 0; bin < ETS_BINS; bin++)
+                {
+                    if(hits[bin] > 0) covered++;
+                    if(hits[bin] < minimum) minimum = hits[bin];
+                }
+                if(covered > bestCovered || (covered == bestCovered && minimum > bestMinimum))
+                {
+                    bestCovered = covered;
+                    bestMinimum = minimum;
+                    intervalClocks = clocks;
+                }
+            }
+            stepQ = ((uint32_t)intervalClocks << ETS_FRACTION_BITS) % periodQ;
+            return intervalClocks;
+        }
+
+        // Forget the signal
+        void clear()
+        {
+            for(uint16_t bin = 0; bin < ETS_BINS; bin++)
+            {
+                binSum[bin] = 0;
+                binCount[bin] = 0;
+            }
+            captures = 0;
+            milliHertz = 0;
+        }
+
+        // Fold in a capture of count samples taken intervalClocks apart.
+        // Returns false if the signal is too flat to align on.
+        bool addCapture(const uint16_t *samples, uint16_t count)
+        {
+            if(milliHertz == 0) return false;
+
+            // Fold relative to the first sample and find where the waveform rises through its middle
+            uint32_t sum[ETS_BINS] = {};
+            uint16_t hits[ETS_BINS] = {};
+            uint32_t phase = 0;
+            for(uint16_t sample = 0; sample < count; sample++)
+            {
+                uint16_t bin = binOf(phase);
+                sum[bin] += samples[sample];
+                hits[bin]++;
+                phase = advance(phase, stepQ);
+            }
+            int16_t folded[ETS_BINS];
+            if(!average(sum, hits, folded)) return false;
+            int16_t low = folded[0];
+            int16_t high = folded[0];
+            for(uint16_t bin = 1; bin < ETS_BINS; bin++)
+            {
+                if(folded[bin] < low) low = folded[bin];
+                if(folded[bin] > high) high = folded[bin];
+            }
+            if(high - low < ETS_MIN_SWING) return false;
+            int16_t middle = (low + high) / 2;
+
+            // The steepest rising crossing, in case noise makes more than one
+            int16_t rise = -1;
+            int16_t steepest = 0;
+            for(uint16_t bin = 0; bin < ETS_BINS; bin++)
+            {
+                int16_t before = folded[(bin + ETS_BINS - 1) % ETS_BINS];
+                if(before >= middle || folded[bin] < middle) continue;
+                int16_t slope = folded[(bin + 1) % ETS_BINS] - folded[(bin + ETS_BINS - 2) % ETS_BINS];
+                if(rise < 0 || slope > steepest)
+                {
+                    rise = bin;
+                    steepest = slope;
+                }
+            }
+            if(rise < 0) return false;
+
+            // Interpolate between the bin centres either side of the crossing
+            int16_t before = folded[(rise + ETS_BINS - 1) % ETS_BINS];
+            uint32_t anchor = (uint32_t)((rise + ETS_BINS - 1) % ETS_BINS) * binQ + binQ / 2 +
+                (uint64_t)binQ * (middle - before) / (folded[rise] - before);
+            if(anchor >= periodQ) anchor -= periodQ;
+
+            // Older captures fade
+            if(captures >= ETS_CAPTURES)
+            {
+                for(uint16_t bin = 0; bin < ETS_BINS; bin++)
+                {
+                    binSum[bin] >>= 1;
+                    binCount[bin] >>= 1;
+                }
+            }
+
+            // Fold again with the crossing at phase zero
+            phase = (anchor == 0)? 0: periodQ - anchor;
+            for(uint16_t sample = 0; sample < count; sample++)
+            {
+                uint16_t bin = binOf(phase);
+                binSum[bin] += samples[sample];
+                binCount[bin]++;
+                phase = advance(phase, stepQ);
+            }
+            captures++;
+            return true;
+        }
+
+        bool ready() { return captures > 0; }
+        uint32_t getMilliHertz() { return milliHertz; }
+        uint32_t getIntervalClocks() { return intervalClocks; }
+
+        // Time across the reconstructed trace
+        uint64_t getSpanNs() { return (milliHertz == 0)? 0: ETS_PERIODS * 1000000000000ULL / milliHertz; }
+
+        // Displayed sample x (0 - NUM_SAMPLES-1), with the rising crossing at x = preTrigger.
+        // Bins no sample has reached yet take the nearest filled one.
+        uint16_t sampleAt(uint16_t x, uint16_t preTrigger)
+        {
+            uint16_t bin = (x + ETS_BINS * ETS_PERIODS - preTrigger % ETS_BINS) % ETS_BINS;
+            for(uint16_t distance = 0; distance <= ETS_BINS / 2; distance++)
+            {
+                uint16_t after = (bin + distance) % ETS_BINS;
+                if(binCount[after] > 0) return binSum[after] / binCount[after];
+                uint16_t before = (bin + ETS_BINS - distance) % ETS_BINS;
+                if(binCount[before] > 0) return binSum[before] / binCount[before];
+            }
+            return 0;
+        }
+
+    private:
+        inline uint16_t binOf(uint32_t phase)
+        {
+            uint32_t bin = phase / binQ;
+            return (bin < ETS_BINS)? bin: ETS_BINS - 1;     // The last bin takes the remainder of the period
+        }
+
+        inline uint32_t advance(uint32_t phase, uint32_t step)
+        {
+            phase += step;
+            return (phase >= periodQ)? phase - periodQ: phase;
+        }
+
+        // Average each bin, filling empty ones from the previous filled bin. False if every bin is empty.
+        static bool average(const uint32_t *sum, const uint16_t *hits, int16_t *folded)
+        {
+            int16_t last = -1;
+            for(uint16_t pass = 0; pass < 2; pass++)
+            {
+                for(uint16_t bin = 0; bin < ETS_BINS; bin++)
+                {
+                    if(hits[bin] > 0) last = sum[bin] / hits[bin];
+                    if(pass == 1) folded[bin] = last;
+                }
+                if(last < 0) return false;
+            }
+            return true;
+        }
+
+        uint32_t binSum[ETS_BINS] = {};
+        uint16_t binCount[ETS_BINS] = {};
+        uint16_t captures = 0;
+        uint32_t milliHertz = 0;        // Frequency the bins are for, 0 if none
+        uint32_t periodQ = 0;           // Period in 1/65536ths of an ADC clock
+        uint32_t binQ = 0;
+        uint32_t stepQ = 0;             // Phase advance from one sample to the next
+        uint32_t intervalClocks = ETS_MIN_CLOCKS;
+};
+
+#endif
@@ -0,0 +1,122 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __GLYPHCACHE_H__
+#define __GLYPHCACHE_H__
+
+// Text drawing from pre-expanded glyphs. The ssd1306 library draws text a font bit at a time, and at
+// scale 2 each bit is four bounds checked pixel writes. Here the builtin font is expanded to display
+// column bytes at compile time for scales 1 and 2, so drawing a glyph is one OR per page per column.
+// When y is not a multiple of 8 the column is shifted and merged into the pages it straddles.
+// host/GlyphBench.cpp checks it against the library and times both.
+
+#include <stdint.h>
+#include "font.h"
+
+#define GLYPH_WIDTH     5       // Columns per glyph in font_8x5
+#define GLYPH_SPACING   1       // Blank columns between glyphs
+#define GLYPH_FIRST     32      // First character in font_8x5
+#define GLYPH_LAST      126     // Last character in font_8x5
+#define GLYPH_COUNT     (GLYPH_LAST - GLYPH_FIRST + 1)
+#define GLYPH_DATA      5       // Offset of the glyph data in font_8x5
+
+struct GlyphTable
+{
+    uint8_t scale1[GLYPH_COUNT][GLYPH_WIDTH];       // One page tall, same as the font
+    uint16_t scale2[GLYPH_COUNT][GLYPH_WIDTH];      // Two pages tall - each column is drawn twice
+};
+
+// Double every bit of a font column: bit n goes to bits 2n and 2n+1
+constexpr uint16_t doubleBits(uint8_t column)
+{
+    uint16_t result = 0;
+    for(int bit = 0; bit < 8; bit++)
+    {
+        if(column & (1 << bit)) result |= 3 << (bit * 2);
+    }
+    return result;
+}
+
+constexpr GlyphTable makeGlyphTable()
+{
+    GlyphTable table = {};
+    for(int glyph = 0; glyph < GLYPH_COUNT; glyph++)
+    {
+        for(int column = 0; column < GLYPH_WIDTH; column++)
+        {
+            uint8_t bits = font_8x5[GLYPH_DATA + glyph * GLYPH_WIDTH + column];
+            table.scale1[glyph][column] = bits;
+            table.scale2[glyph][column] = doubleBits(bits);
+        }
+    }
+    return table;
+}
+
+static_assert(font_8x5[0] == 8 && font_8x5[1] == GLYPH_WIDTH && font_8x5[2] == GLYPH_SPACING &&
+    font_8x5[3] == GLYPH_FIRST && font_8x5[4] == GLYPH_LAST, "GlyphCache does not match font_8x5");
+
+inline constexpr GlyphTable glyphTable = makeGlyphTable();
+
+// OR one column of glyph bits into a page-major display buffer at pixel row y
+inline void blitGlyphColumn(uint8_t *buffer, uint32_t width, uint32_t height, uint32_t x, uint32_t y, uint32_t bits)
+{
+    uint32_t pages = height >> 3;
+    uint32_t page = y >> 3;
+    uint8_t *column = buffer + x;
+    bits <<= (y & 7);   // Zero when page aligned - then each byte goes straight into its page
+    while(bits && page < pages)
+    {
+        column[page * width] |= bits;
+        bits >>= 8;
+        page++;
+    }
+}
+
+// Draw a string in the builtin font at scale 1 or 2 into a page-major display buffer, clipped to the display.
+// Returns false for other scales so the caller can fall back to the ssd1306 library.
+inline bool drawGlyphString(uint8_t *buffer, uint32_t width, uint32_t height, uint32_t x, uint32_t y, uint32_t scale, const char *s)
+{
+    if(scale != 1 && scale != 2) return false;
+    if(y >= height) return true;
+    for(; *s && x < width; s++, x += (GLYPH_WIDTH + GLYPH_SPACING) * scale)
+    {
+        uint8_t c = *s;
+        if(c < GLYPH_FIRST || c > GLYPH_LAST) continue;
+        uint8_t glyph = c - GLYPH_FIRST;
+        for(uint32_t column = 0; column < GLYPH_WIDTH; column++)
+        {
+            uint32_t xpos = x + column * scale;
+            if(scale == 1)
+            {
+                if(xpos >= width) break;
+                blitGlyphColumn(buffer, width, height, xpos, y, glyphTable.scale1[glyph][column]);
+            }
+            else
+            {
+                uint16_t bits = glyphTable.scale2[glyph][column];
+                for(uint32_t repeat = 0; repeat < 2 && xpos + repeat < width; repeat++)
+                {
+                    blitGlyphColumn(buffer, width, height, xpos + repeat, y, bits);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,227 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __HOSTPROTOCOL_H__
+#define __HOSTPROTOCOL_H__
+
+// Binary request/response protocol on the USB serial port. Everything is little endian.
+//   Request:  0xA5, command, payload length (0 - 16), payload, checksum
+//   Response: 0x5A, command, status, payload length (16 bits), payload, checksum
+// The checksum makes the sum of every byte after the sync byte, checksum included, zero (mod 256).
+// Bytes that arrive outside a request are single character text commands, so the port can still be
+// driven from a terminal. The parser takes a byte at a time and never allocates.
+// This file has no Pico SDK dependencies so the host tools can use it.
+//
+// Commands and payloads:
+//   ping         ->  version u8, samples per frame u16, capture buffer u16, timer tick us u16, fastest interval ns u32
+//   setTimebase  sample interval ns u32 (0 follows the signal)  ->  interval that will be used u32
+//   setTrigger   pre-trigger percent u8, optionally followed by level i16 (10 bit, -1 follows the signal),
+//                slope u8 (rising, falling), hysteresis u16 (counts, 0 is taken as 1), holdoff us u32
+//   arm          mode u8 (continuous, single, stop)  ->  sequence of the next frame u32
+//   getFrame     ->  sequence u32, interval ns u32, frequency u32, trigger index i16 (-1 none), flags u8,
+//                    trigger fraction u8 (the level was crossed this many 256ths of a sample after the sample before the trigger index),
+//                    sample count u16, 10 bit samples u16 each, then the lows if it is a peak detect frame.
+//                    Fetching a frame frees its buffer for the next capture.
+//                    In scope mode the display uses up frames too, so the sequence skips the ones it showed.
+//                    In the voltage and frequency modes the host gets every frame.
+//   getMeter     ->  frequency Hz u32, frequency mHz u32, resolution mHz u32, edge counter Hz u32, peak mV u16
+//                    precision mean mV u16, precision peak mV u16
+//                    The peaks are the highest since the previous getMeter. The precision readings are oversampled
+//                    to 14 bits and are only taken while the voltmeter is on show - otherwise they are 0.
+//   stream       sample interval ns u32 (0 stops) - see StreamFrame.h
+//   profile      action u8 (dump, reset) - replies unsupported unless built with BITSCANNER_PROFILE
+//   setAcquire   mode u8 (sample, peak detect, average) - how slow captures reduce the readings between samples
+
+#include <stdint.h>
+
+#define HOST_REQUEST_SYNC       0xA5
+#define HOST_RESPONSE_SYNC      0x5A
+#define HOST_PROTOCOL_VERSION   1
+#define HOST_MAX_REQUEST        16          // Largest request payload
+#define HOST_REQUEST_TIMEOUT_US 100000      // A request that stalls this long is abandoned
+#define HOST_TRIGGER_PAYLOAD    10          // setTrigger with the trigger settings
+
+enum HostCommand : uint8_t
+{
+    hostPing = 1,
+    hostSetTimebase,
+    hostSetTrigger,
+    hostArm,
+    hostGetFrame,
+    hostGetMeter,
+    hostStream,
+    hostProfile,
+    hostSetAcquire
+};
+
+enum HostStatus : uint8_t
+{
+    hostOk = 0,
+    hostBadChecksum,
+    hostBadRequest,         // Unknown command or wrong payload length
+    hostNotReady,           // No frame to fetch yet
+    hostUnsupported,
+    hostBusy                // Try again
+};
+
+enum HostArmMode : uint8_t
+{
+    armContinuous = 0,      // Capture continuously (the default)
+    armSingle,              // Capture one more frame, then stop
+    armStop
+};
+
+#define FRAME_FLAG_TRIGGERED    0x01
+#define FRAME_FLAG_LATE         0x02    // Samples were taken off schedule (see CapturedData::timingSuspect)
+#define FRAME_FLAG_PEAK         0x04    // Peak detect - the samples are the highs, followed by as many lows
+#define FRAME_FLAG_AVERAGE      0x08    // Each sample is the mean of its interval
+
+typedef struct HostRequestStruct
+{
+    uint8_t command = 0;
+    uint8_t length = 0;
+    uint8_t payload[HOST_MAX_REQUEST];
+
+    inline uint8_t get8(uint8_t offset) { return payload[offset]; }
+    inline uint16_t get16(uint8_t offset) { return payload[offset] | (payload[offset + 1] << 8); }
+    inline uint32_t get32(uint8_t offset)
+    {
+        return payload[offset] | (payload[offset + 1] << 8) | (payload[offset + 2] << 16) | ((uint32_t)payload[offset + 3] << 24);
+    }
+} HostRequest;
+
+enum HostParseResult
+{
+    parsePending,       // Byte taken, request not complete
+    parseRequest,       // A request is complete
+    parseBadChecksum,   // A request arrived damaged - its command is known, its payload is not
+    parseText           // Byte is not part of a request
+};
+
+// Incremental request parser. Feed it every byte from the port.
+class HostRequestParser
+{
+    public:
+        HostRequest request;
+
+        inline HostParseResult feed(uint8_t byte, uint64_t nowUs)
+        {
+            if(state != waitingSync && nowUs - lastByteUs > HOST_REQUEST_TIMEOUT_US) state = waitingSync;
+            lastByteUs = nowUs;
+            switch(state)
+            {
+                case waitingSync:
+                    if(byte != HOST_REQUEST_SYNC) return parseText;
+                    state = waitingCommand;
+                    return parsePending;
+                case waitingCommand:
+                    request.command = byte;
+                    sum = byte;
+                    state = waitingLength;
+                    return parsePending;
+                case waitingLength:
+                    if(byte > HOST_MAX_REQUEST)
+                    {
+                        state = waitingSync;    // Can't be a request - look for the next sync
+                        return parsePending;
+                    }
+                    request.length = byte;
+                    received = 0;
+                    sum += byte;
+                    state = (byte == 0)? waitingChecksum: waitingPayload;
+                    return parsePending;
+                case waitingPayload:
+                    request.payload[received++] = byte;
+                    sum += byte;
+                    if(received == request.length) state = waitingChecksum;
+                    return parsePending;
+                case waitingChecksum:
+                    state = waitingSync;
+                    return ((uint8_t)(sum + byte) == 0)? parseRequest: parseBadChecksum;
+            }
+            return parsePending;
+        }
+
+    private:
+        enum ParserState : uint8_t
+        {
+            waitingSync,
+            waitingCommand,
+            waitingLength,
+            waitingPayload,
+            waitingChecksum
+        };
+        ParserState state = waitingSync;
+        uint8_t received = 0;
+        uint8_t sum = 0;
+        uint64_t lastByteUs = 0;
+};
+
+// Builds a response in a caller supplied buffer
+class HostResponse
+{
+    public:
+        HostResponse(uint8_t *buffer, uint16_t capacity) : buffer(buffer), capacity(capacity) {}
+
+        inline void begin(uint8_t command, uint8_t status)
+        {
+            buffer[0] = HOST_RESPONSE_SYNC;
+            buffer[1] = command;
+            buffer[2] = status;
+            length = 5;     // Payload starts after the 16 bit length
+        }
+        inline void put8(uint8_t value) { if(length < capacity - 1) buffer[length++] = value; }
+        inline void put16(uint16_t value) { put8(value); put8(value >> 8); }
+        inline void put32(uint32_t value) { put16(value); put16(value >> 16); }
+
+        // Fill in the length and checksum. Returns the size of the response.
+        inline uint16_t finish()
+        {
+            uint16_t payload = length - 5;
+            buffer[3] = payload;
+            buffer[4] = payload >> 8;
+            uint8_t sum = 0;
+            for(uint16_t index = 1; index < length; index++) sum += buffer[index];
+            buffer[length++] = -sum;
+            return length;
+        }
+
+    private:
+        uint8_t *buffer;
+        uint16_t capacity;
+        uint16_t length = 0;
+};
+
+// Build a request, for the host side. Returns its size.
+inline uint8_t buildHostRequest(uint8_t *out, uint8_t command, const uint8_t *payload, uint8_t length)
+{
+    if(length > HOST_MAX_REQUEST) length = HOST_MAX_REQUEST;
+    out[0] = HOST_REQUEST_SYNC;
+    out[1] = command;
+    out[2] = length;
+    uint8_t sum = command + length;
+    for(uint8_t index = 0; index < length; index++)
+    {
+        out[3 + index] = payload[index];
+        sum += payload[index];
+    }
+    out[3 + length] = -sum;
+    return length + 4;
+}
+
+#endif
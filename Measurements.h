@@ -0,0 +1,253 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __MEASUREMENTS_H__
+#define __MEASUREMENTS_H__
+
+// Waveform measurements taken in one pass over the samples, with integer math and a fixed amount of work
+// per sample, so they can run on every frame or be fed a sample at a time as it arrives.
+// The voltages come straight from the samples. The edges are timed against the 10%, 50% and 90% levels
+// of the previous frame, which is what lets it all happen in one pass: a repetitive signal has the same
+// levels from frame to frame, and when it changes the timings catch up a frame later.
+// The period, pulse width and duty cycle are timed between crossings of the 50% level, which must pass
+// beyond the 10% or 90% level in between so noise doesn't count as an edge. Rise and fall are 10% to 90%.
+// Crossings are interpolated to 1/256th of a sample.
+
+#include <stdint.h>
+#include "CaptureBuffer.h"
+#include "Readout.h"
+
+#define MEASURE_FRACTION_ONE    256     // Crossing positions are in 256ths of a sample
+#define MEASURE_MIN_SWING       8       // A frame flatter than this (in counts) has no edges to time
+#define MEASURE_EDGE_DIVISOR    10      // The edge levels are 1/10th of the swing in from the low and the high
+
+typedef struct WaveformMeasurementsStruct
+{
+    uint16_t minimum = 0;       // Millivolts
+    uint16_t maximum = 0;
+    uint16_t mean = 0;
+    uint16_t rms = 0;           // Of the whole signal, DC included
+    uint16_t samples = 0;       // 0 if nothing was measured
+    // The timings are 0 when the frame had no edges to time them by
+    uint16_t dutyPermille = 0;  // High part of the period
+    uint32_t periodNs = 0;
+    uint32_t pulseWidthNs = 0;  // Time high
+    uint32_t riseNs = 0;        // 10% to 90%
+    uint32_t fallNs = 0;        // 90% to 10%
+
+    uint16_t peakToPeak() { return maximum - minimum; }
+} WaveformMeasurements;
+
+// Square root of a 64 bit value, rounded down. One bit per step, so always 32 steps.
+inline uint32_t integerSquareRoot(uint64_t value)
+{
+    uint64_t root = 0;
+    uint64_t bit = 1ULL << 62;
+    while(bit > value) bit >>= 2;
+    while(bit != 0)
+    {
+        if(value >= root + bit)
+        {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else root >>= 1;
+        bit >>= 2;
+    }
+    return root;
+}
+
+class MeasurementEngine
+{
+    public:
+        // Start a frame of samples taken sampleIntervalNs apart
+        inline void begin(uint32_t sampleIntervalNs)
+        {
+            intervalNs = sampleIntervalNs;
+            count = 0;
+            lowCode = UINT16_MAX;
+            highCode = 0;
+            millivoltSum = 0;
+            squareSum = 0;
+            armedRise = false;
+            armedFall = false;
+            lastRise = -1;
+            lastFall = -1;
+            firstRise = -1;
+            rises = 0;
+            highTotal = 0;
+            highRuns = 0;
+            lowTotal = 0;
+            lowRuns = 0;
+            riseStart = -1;
+            fallStart = -1;
+            riseTotal = 0;
+            riseEdges = 0;
+            fallTotal = 0;
+            fallEdges = 0;
+        }
+
+        // Add the next sample. low is the lowest reading in its interval, which is the sample itself unless peak detecting.
+        inline void add(uint16_t value, uint16_t low)
+        {
+            if(low < lowCode) lowCode = low;
+            if(value > highCode) highCode = value;
+            uint32_t millivolts = adcToMillivolts(value);
+            millivoltSum += millivolts;
+            squareSum += millivolts * millivolts;
+            if(count > 0 && levelsKnown) edges(value);
+            previous = value;
+            count++;
+        }
+
+        // Finish the frame. Its levels are kept for timing the next one.
+        WaveformMeasurements finish()
+        {
+            WaveformMeasurements result;
+            if(count == 0) return result;
+            result.samples = count;
+            result.minimum = adcToMillivolts(lowCode);
+            result.maximum = adcToMillivolts(highCode);
+            result.mean = (millivoltSum + count / 2) / count;
+            result.rms = integerSquareRoot((squareSum + count / 2) / count);
+            if(rises > 1) result.periodNs = toNs(lastRise - firstRise) / (rises - 1);
+            if(highRuns > 0) result.pulseWidthNs = toNs(highTotal) / highRuns;
+            if(highRuns > 0 && lowRuns > 0)
+            {
+                // Average high and low times, so a frame with an extra high run isn't biased
+                uint64_t high = (uint64_t)highTotal * lowRuns;
+                uint64_t low = (uint64_t)lowTotal * highRuns;
+                result.dutyPermille = (high * 1000 + (high + low) / 2) / (high + low);
+                if(result.periodNs == 0) result.periodNs = toNs(highTotal) / highRuns + toNs(lowTotal) / lowRuns;
+            }
+            if(riseEdges > 0) result.riseNs = toNs(riseTotal) / riseEdges;
+            if(fallEdges > 0) result.fallNs = toNs(fallTotal) / fallEdges;
+
+            // Levels for the next frame
+            levelsKnown = highCode >= lowCode + MEASURE_MIN_SWING;
+            uint16_t edge = (highCode - lowCode) / MEASURE_EDGE_DIVISOR;
+            lowLevel = lowCode + edge;
+            middleLevel = (lowCode + highCode) / 2;
+            highLevel = highCode - edge;
+            return result;
+        }
+
+        // One pass over the displayed samples of a completed frame
+        WaveformMeasurements measure(CapturedData &frame)
+        {
+            begin(frame.sampleIntervalNs);
+            for(uint16_t x = 0; x < NUM_SAMPLES; x++) add(frame.sampleAt(x), frame.lowAt(x));
+            return finish();
+        }
+
+    private:
+        // Where between the previous sample and this one the level was crossed
+        inline int32_t crossing(int32_t value, int32_t level)
+        {
+            int32_t last = previous;
+            return (int32_t)(count - 1) * MEASURE_FRACTION_ONE + (level - last) * MEASURE_FRACTION_ONE / (value - last);
+        }
+
+        inline bool crossedUp(int32_t value, int32_t level) { return previous < level && value >= level; }
+        inline bool crossedDown(int32_t value, int32_t level) { return previous > level && value <= level; }
+
+        inline void edges(int32_t value)
+        {
+            // Rise time runs from the 10% level to the 90% level, and starts over if the signal drops back
+            if(crossedUp(value, lowLevel)) riseStart = crossing(value, lowLevel);
+            else if(value < lowLevel) riseStart = -1;
+            if(crossedUp(value, highLevel) && riseStart >= 0)
+            {
+                riseTotal += crossing(value, highLevel) - riseStart;
+                riseEdges++;
+                riseStart = -1;
+            }
+            if(crossedDown(value, highLevel)) fallStart = crossing(value, highLevel);
+            else if(value > highLevel) fallStart = -1;
+            if(crossedDown(value, lowLevel) && fallStart >= 0)
+            {
+                fallTotal += crossing(value, lowLevel) - fallStart;
+                fallEdges++;
+                fallStart = -1;
+            }
+
+            // Crossings of the middle, armed by the signal reaching the far edge level
+            if(armedRise && crossedUp(value, middleLevel))
+            {
+                int32_t at = crossing(value, middleLevel);
+                if(firstRise < 0) firstRise = at;
+                if(lastFall >= 0)
+                {
+                    lowTotal += at - lastFall;
+                    lowRuns++;
+                }
+                lastRise = at;
+                rises++;
+                armedRise = false;
+            }
+            if(armedFall && crossedDown(value, middleLevel))
+            {
+                int32_t at = crossing(value, middleLevel);
+                if(lastRise >= 0)
+                {
+                    highTotal += at - lastRise;
+                    highRuns++;
+                }
+                lastFall = at;
+                armedFall = false;
+            }
+            if(value <= lowLevel) armedRise = true;
+            if(value >= highLevel) armedFall = true;
+        }
+
+        inline uint32_t toNs(uint32_t positions) { return (uint64_t)positions * intervalNs / MEASURE_FRACTION_ONE; }
+
+        uint32_t intervalNs = 0;
+        uint16_t count = 0;
+        uint16_t previous = 0;
+        uint16_t lowCode = UINT16_MAX;
+        uint16_t highCode = 0;
+        uint32_t millivoltSum = 0;
+        uint64_t squareSum = 0;
+
+        // Levels from the previous frame, in counts
+        bool levelsKnown = false;
+        int32_t lowLevel = 0;
+        int32_t middleLevel = 0;
+        int32_t highLevel = 0;
+
+        // Edges so far, in 256ths of a sample from the start of the frame
+        bool armedRise = false;
+        bool armedFall = false;
+        int32_t lastRise = -1;
+        int32_t lastFall = -1;
+        int32_t firstRise = -1;
+        uint16_t rises = 0;
+        uint32_t highTotal = 0;
+        uint16_t highRuns = 0;
+        uint32_t lowTotal = 0;
+        uint16_t lowRuns = 0;
+        int32_t riseStart = -1;
+        int32_t fallStart = -1;
+        uint32_t riseTotal = 0;
+        uint16_t riseEdges = 0;
+        uint32_t fallTotal = 0;
+        uint16_t fallEdges = 0;
+};
+
+#endif
@@ -0,0 +1,69 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __OVERSAMPLER_H__
+#define __OVERSAMPLER_H__
+
+// Oversampling and decimation of full 12 bit ADC readings. Every 4x oversampling adds a bit when there is
+// noise of a count or so to dither the readings, which the RP2040's ADC always has. Groups of 16 readings
+// give 14 bit values for the peak and low; the mean of the whole block is also taken to 14 bits, with
+// the rest of the block averaging the noise down further.
+// A 14 bit code is 16 times the 10 bit code the rest of the firmware uses.
+// host/OversamplerTest.cpp checks its error bounds on noisy synthetic readings.
+
+#include <stdint.h>
+
+#define OVERSAMPLE_GROUP    16      // Readings in each 14 bit value
+#define OVERSAMPLE_MASK     0x0FFF  // 12 bit reading
+
+typedef struct PrecisionReadingStruct
+{
+    uint16_t mean = 0;      // 14 bit codes
+    uint16_t peak = 0;
+    uint16_t low = 0;
+    uint16_t count = 0;     // Readings taken, 0 if there is no reading
+} PrecisionReading;
+
+// Reduce a block of 12 bit readings. Readings beyond the last whole group are ignored.
+inline PrecisionReading oversample(const uint16_t *samples, uint16_t count)
+{
+    PrecisionReading reading;
+    uint16_t groups = count / OVERSAMPLE_GROUP;
+    if(groups == 0) return reading;
+    uint32_t total = 0;             // At most 4095 * 65535, so 32 bits is plenty
+    uint16_t peak = 0;
+    uint16_t low = UINT16_MAX;
+    for(uint16_t group = 0; group < groups; group++)
+    {
+        uint32_t groupSum = 0;
+        const uint16_t *readings = samples + group * OVERSAMPLE_GROUP;
+        for(uint16_t index = 0; index < OVERSAMPLE_GROUP; index++) groupSum += readings[index] & OVERSAMPLE_MASK;
+        total += groupSum;
+        uint16_t value = (groupSum + 2) >> 2;   // Sum of 16 is 16 bits - drop 2 for 14
+        if(value > peak) peak = value;
+        if(value < low) low = value;
+    }
+    uint32_t readings = groups * OVERSAMPLE_GROUP;
+    reading.mean = ((uint64_t)total * 4 + readings / 2) / readings;
+    reading.peak = peak;
+    reading.low = low;
+    reading.count = readings;
+    return reading;
+}
+
+#endif
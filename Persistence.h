@@ -0,0 +1,122 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __PERSISTENCE_H__
+#define __PERSISTENCE_H__
+
+// Display persistence. Every pixel of the trace area remembers the capture that last drew through it, so
+// a glitch or jitter stays on screen for a number of captures after it happened. Adding a capture touches
+// only the pixels its trace covers; nothing is redrawn and there is no pass over the whole map to fade it.
+// Hits are stamped with an 8 bit capture number, and each capture clears the expired hits in one column
+// so an old stamp is gone before the number comes round again.
+// The display is one bit deep, so recent hits are drawn solid and older ones in a half tone.
+
+#include <stdint.h>
+#include "CaptureBuffer.h"
+
+#define PERSIST_COLUMNS         NUM_SAMPLES
+#define PERSIST_ROWS            32
+#define PERSIST_OFF             0
+#define PERSIST_DEFAULT_FRAMES  32      // Captures a hit stays on show
+#define PERSIST_MAX_FRAMES      (255 - PERSIST_COLUMNS - 1)     // Expired hits must be swept before their stamp comes round again
+#define PERSIST_FOREVER         255     // Keep every hit until cleared
+#define PERSIST_NEVER           0       // Stamp of a pixel with no hit
+
+class Persistence
+{
+    public:
+        // Forget every hit
+        void clear()
+        {
+            for(uint16_t column = 0; column < PERSIST_COLUMNS; column++)
+            {
+                for(uint16_t row = 0; row < PERSIST_ROWS; row++) hits[column][row] = PERSIST_NEVER;
+            }
+            empty = true;
+        }
+
+        // Captures a hit stays on show (up to PERSIST_MAX_FRAMES), or PERSIST_FOREVER
+        void setFrames(uint8_t persistFrames)
+        {
+            frames = (persistFrames == PERSIST_FOREVER || persistFrames <= PERSIST_MAX_FRAMES)? persistFrames: PERSIST_MAX_FRAMES;
+        }
+        uint8_t getFrames() { return frames; }
+        bool isEmpty() { return empty; }
+
+        // Start adding a capture. Ages every hit by one and sweeps the expired ones from a column.
+        void nextCapture()
+        {
+            stamp++;
+            if(stamp == PERSIST_NEVER) stamp++;
+            if(frames != PERSIST_FOREVER)
+            {
+                uint8_t *column = hits[sweepColumn];
+                for(uint16_t row = 0; row < PERSIST_ROWS; row++)
+                {
+                    if(column[row] != PERSIST_NEVER && age(column[row]) >= frames) column[row] = PERSIST_NEVER;
+                }
+            }
+            if(++sweepColumn == PERSIST_COLUMNS) sweepColumn = 0;
+        }
+
+        // The capture's trace covers rows y1 to y2 (either order) of column x
+        inline void addSpan(uint16_t x, uint8_t y1, uint8_t y2)
+        {
+            if(x >= PERSIST_COLUMNS) return;
+            if(y1 > y2)
+            {
+                uint8_t swap = y1;
+                y1 = y2;
+                y2 = swap;
+            }
+            if(y2 >= PERSIST_ROWS) y2 = PERSIST_ROWS - 1;
+            for(uint16_t row = y1; row <= y2; row++) hits[x][row] = stamp;
+            empty = false;
+        }
+
+        // Draw into the first PERSIST_COLUMNS columns and height rows of a page-major one bit display buffer,
+        // ORed with what is there. Hits from the last quarter of the persistence are solid.
+        void render(uint8_t *buffer, uint32_t width, uint32_t height)
+        {
+            uint8_t rows = (height < PERSIST_ROWS)? height: PERSIST_ROWS;
+            uint8_t recent = (frames == PERSIST_FOREVER)? PERSIST_FOREVER: (frames + 3) / 4;
+            for(uint16_t column = 0; column < PERSIST_COLUMNS; column++)
+            {
+                const uint8_t *cells = hits[column];
+                for(uint8_t row = 0; row < rows; row++)
+                {
+                    if(cells[row] == PERSIST_NEVER) continue;
+                    uint8_t hitAge = age(cells[row]);
+                    bool lit = (frames == PERSIST_FOREVER) || hitAge < recent || (hitAge < frames && ((column + row) & 1) == 0);
+                    if(lit) buffer[column + width * (row >> 3)] |= 1 << (row & 7);
+                }
+            }
+        }
+
+    private:
+        // Captures since a stamp. The skipped PERSIST_NEVER makes this one short after the count wraps, which doesn't show.
+        inline uint8_t age(uint8_t hitStamp) { return stamp - hitStamp; }
+
+        uint8_t hits[PERSIST_COLUMNS][PERSIST_ROWS] = {};    // Stamp of the last capture through each pixel
+        uint8_t stamp = 1;
+        uint8_t frames = PERSIST_DEFAULT_FRAMES;
+        uint16_t sweepColumn = 0;
+        bool empty = true;
+};
+
+#endif
@@ -0,0 +1,139 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include "Profiler.h"
+
+#ifdef BITSCANNER_PROFILE
+
+#if PICO_ON_DEVICE
+#include "hardware/clocks.h"
+#endif
+
+ProfileStats Profiler::stats[(int)ProfileRegion::count];
+
+static const char *regionNames[(int)ProfileRegion::count] =
+{
+    "sampling isr",
+    "dma isr",
+    "baseline",
+    "freq gate",
+    "render",
+    "display flush",
+    "poll loop",
+    "stream isr",
+    "stream send",
+    "equivalent time",
+    "voltmeter",
+    "measurements",
+    "spectrum",
+    "persistence",
+    "roll",
+    "deep record"
+};
+
+void Profiler::startCore()
+{
+#if PICO_ON_DEVICE
+    systick_hw->rvr = 0x00FFFFFF;
+    systick_hw->cvr = 0;
+    systick_hw->csr = 0x5;      // Enabled, counting processor clocks, no interrupt
+#endif
+}
+
+// Four buckets per power of two: the top bit picks the octave and the next two bits the quarter
+uint8_t Profiler::bucketFor(uint32_t elapsed)
+{
+    if(elapsed < 4) return elapsed;
+    uint8_t topBit = 31 - __builtin_clz(elapsed);
+    uint8_t bucket = (topBit - 1) * 4 + ((elapsed >> (topBit - 2)) & 3);
+    return (bucket < PROFILE_BUCKETS)? bucket: PROFILE_BUCKETS - 1;
+}
+
+uint32_t Profiler::bucketTop(uint8_t bucket)
+{
+    if(bucket < 4) return bucket;
+    uint8_t shift = bucket / 4 - 1;
+    return ((4 + bucket % 4 + 1) << shift) - 1;
+}
+
+void Profiler::record(ProfileRegion region, uint32_t elapsed)
+{
+    ProfileStats &regionStats = stats[(int)region];
+    if(regionStats.resetRequested) regionStats = ProfileStats();
+    regionStats.count++;
+    regionStats.total += elapsed;
+    if(elapsed < regionStats.min) regionStats.min = elapsed;
+    if(elapsed > regionStats.max) regionStats.max = elapsed;
+    regionStats.buckets[bucketFor(elapsed)]++;
+}
+
+// Regions are cleared by the core that records them the next time it does
+void Profiler::reset()
+{
+    for(int region = 0; region < (int)ProfileRegion::count; region++) stats[region].resetRequested = true;
+}
+
+// Print a time in hundredths of a microsecond
+static void printMicroseconds(uint64_t elapsed, uint32_t ticksPerMicrosecond)
+{
+    uint64_t hundredths = elapsed * 100 / ticksPerMicrosecond;
+    printf(" %8llu.%02u", (unsigned long long)(hundredths / 100), (unsigned)(hundredths % 100));
+}
+
+void Profiler::dump()
+{
+#if PICO_ON_DEVICE
+    uint32_t ticksPerMicrosecond = clock_get_hz(clk_sys) / 1000000;
+#else
+    uint32_t ticksPerMicrosecond = 1;
+#endif
+    printf("region           count      min(us)     avg(us)     max(us)     p99(us)\n");
+    for(int region = 0; region < (int)ProfileRegion::count; region++)
+    {
+        ProfileStats regionStats = stats[region];    // Copy - the other core may be recording
+        printf("%-14s %8lu", regionNames[region], (unsigned long)regionStats.count);
+        if(regionStats.count == 0 || regionStats.resetRequested)
+        {
+            printf("\n");
+            continue;
+        }
+
+        // The 99th percentile is reported as the top of its bucket, within 25%, and never above the max
+        uint32_t target = regionStats.count - regionStats.count / 100;
+        uint32_t seen = 0;
+        uint32_t p99 = regionStats.max;
+        for(uint8_t bucket = 0; bucket < PROFILE_BUCKETS; bucket++)
+        {
+            seen += regionStats.buckets[bucket];
+            if(seen >= target)
+            {
+                if(bucketTop(bucket) < p99) p99 = bucketTop(bucket);
+                break;
+            }
+        }
+
+        printMicroseconds(regionStats.min, ticksPerMicrosecond);
+        printMicroseconds(regionStats.total / regionStats.count, ticksPerMicrosecond);
+        printMicroseconds(regionStats.max, ticksPerMicrosecond);
+        printMicroseconds(p99, ticksPerMicrosecond);
+        printf("\n");
+    }
+}
+
+#endif
@@ -0,0 +1,129 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+// Region profiler. PROFILE_REGION(name) at the top of a block times the rest of the block and adds it to
+// that region's statistics: count, min, average, max and a histogram for the 99th percentile. Everything
+// lives in a fixed table, so recording never allocates and is safe in an interrupt.
+//
+// Build with BITSCANNER_PROFILE defined to enable it (see CMakeLists.txt). Without it the macros are empty
+// and none of this is compiled in. Send 'p' over USB stdio to print the table and 'r' to reset it.
+//
+// On the device times are SysTick cycles. SysTick is 24 bits, so a region longer than 2^24 cycles
+// (134ms at 125MHz) reads short. Each core has its own SysTick and PROFILE_START_CORE enables it.
+// Elsewhere times are microseconds from time_us_32.
+
+#include <stdint.h>
+#include "pico/stdlib.h"
+
+#if PICO_ON_DEVICE
+#include "hardware/structs/systick.h"
+#endif
+
+#define PROFILE_BUCKETS 96      // 4 buckets per power of two up to 2^24
+
+enum class ProfileRegion : uint8_t
+{
+    samplingIsr,        // Capture::timerCallback
+    dmaIsr,             // Capture::dmaCallback
+    baselineUpdate,     // Crossing detector baseline tracking
+    frequencyGate,      // Gated frequency count
+    render,             // Drawing a screen into the frame buffer
+    displayFlush,       // Finding the changed bytes and starting the display DMA
+    pollLoop,           // One pass of Scope::poll
+    streamIsr,          // Streamer::dmaCallback
+    streamSend,         // Packing and sending stream frames over USB
+    equivalentTime,     // Folding a capture into the equivalent time waveform
+    voltmeter,          // Oversampling a precision voltmeter burst
+    measurements,       // Measuring a completed frame
+    spectrum,           // Windowing and transforming a spectrum block
+    persistence,        // Adding a capture to the persistence map
+    roll,               // Drawing roll samples at the sweep cursor
+    deepRecord,         // Packing stream blocks into the deep record
+    count
+};
+
+typedef struct ProfileStatsStruct
+{
+    uint32_t count = 0;
+    uint32_t min = UINT32_MAX;
+    uint32_t max = 0;
+    uint64_t total = 0;
+    uint32_t buckets[PROFILE_BUCKETS] = {};
+    volatile bool resetRequested = false;   // Set by the reader, honoured by the core that records the region
+} ProfileStats;
+
+class Profiler
+{
+    public:
+        static inline uint32_t now()
+        {
+#if PICO_ON_DEVICE
+            return systick_hw->cvr;
+#else
+            return time_us_32();
+#endif
+        }
+
+        // Elapsed time since a value from now()
+        static inline uint32_t since(uint32_t start)
+        {
+#if PICO_ON_DEVICE
+            return (start - systick_hw->cvr) & 0x00FFFFFF;     // Counts down
+#else
+            return time_us_32() - start;
+#endif
+        }
+
+        static void startCore();
+        static void record(ProfileRegion region, uint32_t elapsed);
+        static void reset();
+        static void dump();
+
+    private:
+        static uint8_t bucketFor(uint32_t elapsed);
+        static uint32_t bucketTop(uint8_t bucket);
+
+        static ProfileStats stats[(int)ProfileRegion::count];
+};
+
+class ProfileScope
+{
+    public:
+        ProfileScope(ProfileRegion region) : region(region), start(Profiler::now()) {}
+        ~ProfileScope() { Profiler::record(region, Profiler::since(start)); }
+
+    private:
+        ProfileRegion region;
+        uint32_t start;
+};
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+
+#ifdef BITSCANNER_PROFILE
+#define PROFILE_REGION(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(ProfileRegion::name)
+#define PROFILE_START_CORE() Profiler::startCore()
+#else
+#define PROFILE_REGION(name)
+#define PROFILE_START_CORE()
+#endif
+
+#endif
@@ -0,0 +1,133 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __READOUT_H__
+#define __READOUT_H__
+
+// Integer measurement and text formatting. The RP2040 has no FPU, so the voltage conversion is a table
+// computed at compile time and numbers are formatted without printf's floating point support.
+// host/ReadoutTest.cpp checks the readouts against the float code they replaced.
+
+#include <stdint.h>
+#include <string.h>
+
+// Adjust R1 and R2 to measured values if you wish to calibrate
+#define R1  15.0  // R1 used in voltage divider
+#define R2  27.0  // R2 used in voltage divider
+
+#define ADC_CODES   1024    // 10 bit samples
+
+constexpr double TOP_OF_RANGE = 3.3 * (R1 + R2) / R2;    // Measured top of range based on voltage divider
+constexpr uint16_t TOP_OF_RANGE_MV = TOP_OF_RANGE * 1000;
+
+struct MillivoltTable
+{
+    uint16_t millivolts[ADC_CODES];
+};
+
+// We subract 10 to round the lowest 0.05 V to ground
+// We increase the range by 0.1V to account for rounding the lowest to ground and highest to 5V
+// Millivolts are truncated so rounding them to tenths gives the same result as rounding the exact voltage.
+constexpr MillivoltTable makeMillivoltTable()
+{
+    MillivoltTable table = {};
+    for(int adcvalue = 0; adcvalue < ADC_CODES; adcvalue++)
+    {
+        double actualVoltage = (adcvalue - 10) * TOP_OF_RANGE / (1023-20);
+        if(actualVoltage<0) actualVoltage = 0;
+        if(actualVoltage>TOP_OF_RANGE) actualVoltage = TOP_OF_RANGE;
+        table.millivolts[adcvalue] = actualVoltage * 1000;
+    }
+    return table;
+}
+
+inline constexpr MillivoltTable adcMillivolts = makeMillivoltTable();
+
+inline uint16_t adcToMillivolts(uint16_t adcvalue)
+{
+    return adcMillivolts.millivolts[(adcvalue < ADC_CODES)? adcvalue: ADC_CODES-1];
+}
+
+// Millivolts for a 14 bit oversampled code (16 per 10 bit count) on the same scale as the table.
+// Rounded rather than truncated - the extra bits are there to be shown.
+inline uint16_t precisionToMillivolts(uint16_t code)
+{
+    constexpr uint64_t TOP_OF_RANGE_UV = TOP_OF_RANGE * 1000000;
+    constexpr uint64_t SCALE = (1023 - 20) * 16 * 1000ULL;    // Codes across the range, times 1000 to take microvolts to millivolts
+    int32_t counts = (int32_t)code - 10 * 16;
+    if(counts <= 0) return 0;
+    uint64_t millivolts = (counts * TOP_OF_RANGE_UV + SCALE / 2) / SCALE;
+    return (millivolts > TOP_OF_RANGE_MV)? TOP_OF_RANGE_MV: millivolts;
+}
+
+// Format a fixed point value followed by a suffix. value is in units of 10^-scaleDigits
+// (for example millivolts have scaleDigits 3 for volts). decimals (<= scaleDigits) digits are shown
+// after the decimal point, rounding half up. Returns buffer.
+inline char *formatFixed(char *buffer, uint32_t value, uint8_t scaleDigits, uint8_t decimals, const char *suffix)
+{
+    uint32_t divisor = 1;
+    for(uint8_t digit = decimals; digit < scaleDigits; digit++) divisor *= 10;
+    if(divisor > 1) value = value / divisor + ((value % divisor) >= divisor/2);
+
+    char digits[12];
+    uint8_t count = 0;
+    do
+    {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while(value > 0 || count <= decimals);
+
+    char *out = buffer;
+    while(count > 0)
+    {
+        *out++ = digits[--count];
+        if(count == decimals && decimals > 0) *out++ = '.';
+    }
+    while(*suffix) *out++ = *suffix++;
+    *out = 0;
+    return buffer;
+}
+
+// Format a time span as at most three significant digits, without trailing zeros, in the largest unit
+// that keeps it at 1 or more (for example 2500000 ns is "2.5" ms). Returns the unit.
+inline const char *formatTimeSpan(char *buffer, uint64_t ns)
+{
+    const char *unit = "us";
+    uint32_t value = ns;        // Thousandths of the unit
+    if(ns >= 1000000000)
+    {
+        unit = "sec";
+        value = ns / 1000000;
+    }
+    else if(ns >= 1000000)
+    {
+        unit = "ms";
+        value = ns / 1000;
+    }
+    uint8_t decimals = (value < 10000)? 2: (value < 100000)? 1: 0;
+    formatFixed(buffer, value, 3, decimals, "");
+    if(decimals > 0)
+    {
+        char *end = buffer + strlen(buffer) - 1;
+        while(*end == '0') *end-- = 0;
+        if(*end == '.') *end = 0;
+    }
+    return unit;
+}
+
+#endif
@@ -0,0 +1,102 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __RECIPROCALCOUNTER_H__
+#define __RECIPROCALCOUNTER_H__
+
+// Reciprocal frequency counter. Instead of counting cycles in a fixed gate, it timestamps rising crossings
+// and divides the number of whole periods by the time they took. Resolution depends on the timestamp
+// resolution rather than the gate, so a 3Hz signal reads to a fraction of a millihertz after one period.
+// All math is integer.
+
+#include <stdint.h>
+
+#define RECIPROCAL_CHECKPOINT_US    100000  // Minimum time between checkpoints (and so between readings)
+#define RECIPROCAL_SPAN_US          1000000 // Readings average over up to this much history
+#define RECIPROCAL_TIMEOUT_US       2000000 // No crossing for this long and there is no reading
+#define RECIPROCAL_CHECKPOINTS      16      // Must cover RECIPROCAL_SPAN_US / RECIPROCAL_CHECKPOINT_US plus one
+
+typedef struct FrequencyMeasurementStruct
+{
+    uint32_t milliHertz = 0;            // Frequency in thousandths of a Hz
+    uint32_t resolutionMilliHertz = 0;  // Reading is uncertain by this much (timestamp or count quantization)
+    uint32_t cycles = 0;                // Signal periods the reading is based on. Zero means no reading.
+
+    inline uint32_t hertz() { return (milliHertz + 500) / 1000; }
+} FrequencyMeasurement;
+
+class ReciprocalCounter
+{
+    public:
+        // Record a qualified rising crossing. timeUs must not go backwards.
+        // tickUs is the timestamp resolution (the sample interval).
+        void crossing(uint64_t timeUs, uint32_t tickUs)
+        {
+            totalCrossings++;
+            lastCrossingTime = timeUs;
+            if(checkpointCount > 0 && timeUs - checkpointTime[newest] < RECIPROCAL_CHECKPOINT_US) return;
+
+            // New checkpoint
+            newest = (newest + 1) % RECIPROCAL_CHECKPOINTS;
+            checkpointTime[newest] = timeUs;
+            checkpointCrossings[newest] = totalCrossings;
+            if(checkpointCount < RECIPROCAL_CHECKPOINTS) checkpointCount++;
+            if(checkpointCount < 2) return;
+
+            // Find the oldest checkpoint within the averaging span. Always use at least the previous one.
+            uint16_t oldest = (newest + RECIPROCAL_CHECKPOINTS - 1) % RECIPROCAL_CHECKPOINTS;
+            for(uint16_t back = 2; back < checkpointCount; back++)
+            {
+                uint16_t candidate = (newest + RECIPROCAL_CHECKPOINTS - back) % RECIPROCAL_CHECKPOINTS;
+                if(timeUs - checkpointTime[candidate] > RECIPROCAL_SPAN_US) break;
+                oldest = candidate;
+            }
+            uint32_t cycles = checkpointCrossings[newest] - checkpointCrossings[oldest];
+            uint64_t elapsed = timeUs - checkpointTime[oldest];
+            if(elapsed == 0) return;
+            uint64_t milliHertz = (cycles * 1000000000ULL + elapsed/2) / elapsed;
+            measurement.milliHertz = milliHertz;
+            // Each timestamp may be off by a tick - the period is uncertain by one tick over the whole span
+            measurement.resolutionMilliHertz = (milliHertz * tickUs + elapsed - 1) / elapsed;
+            measurement.cycles = cycles;
+        }
+
+        // Returns the latest reading, or an empty one if the signal has stopped
+        FrequencyMeasurement getMeasurement(uint64_t currentTime)
+        {
+            if(checkpointCount == 0 || currentTime - lastCrossingTime > RECIPROCAL_TIMEOUT_US) reset();
+            return measurement;
+        }
+
+        void reset()
+        {
+            checkpointCount = 0;
+            measurement = FrequencyMeasurement();
+        }
+
+    private:
+        uint64_t checkpointTime[RECIPROCAL_CHECKPOINTS];        // Timestamp of the crossing that made each checkpoint
+        uint32_t checkpointCrossings[RECIPROCAL_CHECKPOINTS];   // Total crossings at each checkpoint
+        uint16_t newest = 0;
+        uint16_t checkpointCount = 0;
+        uint32_t totalCrossings = 0;
+        uint64_t lastCrossingTime = 0;
+        FrequencyMeasurement measurement;
+};
+
+#endif
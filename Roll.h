@@ -0,0 +1,87 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ROLL_H__
+#define __ROLL_H__
+
+// Roll mode for slow timebases. Rather than filling a frame and waiting for a trigger, the timer engine
+// hands each sample to core0 as soon as it is taken, and the trace is drawn a column at a time like a
+// chart recorder. The panel can't scroll, so instead of moving the whole trace the newest sample is drawn
+// at a cursor that sweeps left to right and wraps, with a blank column ahead of it separating the new trace
+// from the old. Each sample changes at most two columns, which the display sends in about 1 ms - well inside
+// the shortest roll interval. What is on screen is never more than a sample interval old.
+
+#include <stdint.h>
+#include "CaptureBuffer.h"
+#include "SpscQueue.h"
+
+#define ROLL_MIN_INTERVAL_NS    5000000     // Screens of half a second and longer roll
+#define ROLL_QUEUE_SIZE         64          // Samples core1 can get ahead of the display
+
+typedef struct RollSampleStruct
+{
+    uint16_t value = 0;
+    uint16_t low = 0;       // Lowest reading in the interval in peak detect mode, otherwise the value
+} RollSample;
+
+typedef struct RollRequestStruct
+{
+    uint16_t divisor = 0;   // Timer ticks per sample, 0 to stop rolling
+    AcquireMode acquireMode = acquireSample;
+} RollRequest;
+
+typedef SpscQueue<RollSample, ROLL_QUEUE_SIZE> RollQueue;
+
+// The last NUM_SAMPLES samples, laid out as the screen shows them: column x holds samples[x]
+class RollBuffer
+{
+    public:
+        void clear()
+        {
+            count = 0;
+            next = 0;
+        }
+
+        // Store a sample at the cursor and move the cursor on. Returns the column it went in.
+        uint16_t add(const RollSample &sample)
+        {
+            uint16_t column = next;
+            samples[column] = sample;
+            if(++next == NUM_SAMPLES) next = 0;
+            if(count < NUM_SAMPLES) count++;
+            return column;
+        }
+
+        uint16_t getCount() { return count; }
+
+        // The column ahead of the cursor, kept blank. Holds the oldest sample once the buffer is full.
+        uint16_t getGap() { return next; }
+
+        // Column x of the screen shows a sample. Until the first sweep is done the columns right of the cursor are empty.
+        bool filled(uint16_t x) { return x < count && x != next; }
+
+        // The sample in column x
+        const RollSample &at(uint16_t x) { return samples[x]; }
+
+    private:
+        RollSample samples[NUM_SAMPLES];
+        uint16_t next = 0;      // The cursor - where the next sample goes
+        uint16_t count = 0;
+};
+
+#endif
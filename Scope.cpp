@@ -16,178 +16,832 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */    
 
+#include <string.h>
 #include "Scope.h"
-#include <cmath>
+#include "pico/stdio_usb.h"
 extern "C"
 {
     #include "ssd1306.h"
     #include "font.h"
 }
+#include "GlyphCache.h"
+#include "Profiler.h"
 extern ssd1306_t disp;  // Reference to the diplay (see tineyscopepico.cpp)
 
+static uint8_t streamFrame[sizeof(StreamFrameHeader) + STREAM_MAX_PAYLOAD];    // Frame being sent over USB
+static uint8_t hostResponse[32 + NUM_SAMPLES * 4];     // Response being sent over USB - the largest is a peak detect frame
+static EquivalentTime equivalentTime;   // Waveform rebuilt from equivalent time captures. Too big for the Scope's stack.
+static SpectrumBlock spectrumBlock;     // Readings for the spectrum, filled by core1
+static Spectrum currentSpectrum;              // Latest spectrum
+static Persistence persistence;                 // Scope traces on show in persistence mode
+static DeepRecord deepRecord;                   // Most of the RAM - only static memory has room for it
+
+static_assert(DISPLAYHEIGHT <= PERSIST_ROWS, "Persistence map is shorter than the display");
+
+// Text at scale 1 and 2 comes from the pre-expanded glyph cache. Anything else goes through the library.
+static void drawString(uint32_t x, uint32_t y, uint32_t scale, const char *s)
+{
+    if(!drawGlyphString(disp.buffer, disp.width, disp.height, x, y, scale, s)) ssd1306_draw_string(&disp, x, y, scale, s);
+}
+
+// Label the scope trace with the time across it
+static void drawTimescale(uint64_t spanNs)
+{
+    char timescale[12];
+    const char *unit = formatTimeSpan(timescale, spanNs);
+    drawString(102, (DISPLAYHEIGHT - 16)/2, 1, timescale );
+    drawString(102, (DISPLAYHEIGHT - 16)/2 + 8, 1, unit );
+}
+
 Scope::Scope()
 {
 }
 
 Scope::~Scope()
 {
-    delete adcCapture;
-    adcCapture = NULL;
 }
 
-uint16_t Scope::getCurrentFrequency()
+// The edge counter is good for any frequency but only sees signals that cross the GPIO logic thresholds.
+// The software counter adapts to small signals but is limited by the 40Khz sampling rate.
+uint32_t Scope::getCurrentFrequency()
 {
-    return adcCapture->getFrequency();
+    if(edgeFrequency > SOFTWARE_FREQUENCY_LIMIT || (edgeFrequency > 0 && currentFrequency == 0)) return edgeFrequency;
+    return currentFrequency;
 }
 
-float Scope::getCurrentVoltage()
+uint16_t Scope::getCurrentMillivolts()
 {
-    return getVoltageFromADCValue(adcCapture->getPeakVoltage());
+    uint16_t peakADC = peakADCSinceLastRequest;
+    peakADCSinceLastRequest = 0;
+    return getMillivoltsFromADCValue(peakADC);
 }
 
-float Scope::getVoltageFromADCValue(uint16_t adcvalue)
+
+bool Scope::startCaptureBasedOnFrequency()
 {
-    // We subract 10 to round the lowest 0.05 V to ground
-    // We increase the range by 0.1V to account for rounding the lowest to ground and highest to 5V
-    float actualVoltage = (adcvalue - 10) * topOfRange / (1023-20);
-    if(actualVoltage<0) actualVoltage = 0;
-    if(actualVoltage>topOfRange) actualVoltage = topOfRange;
-    return std::round(actualVoltage * 10) / 10;
+    if(captureInProgress || streaming || rollDivisor != 0 || captureArm == armStop) return false; // Already capturing, the ADC is streaming or rolling, or the host stopped capturing
+    // The voltmeter and spectrum take the ADC between captures, and slow captures would hold them up. Only a host needs frames now.
+    if((currentDisplayMode == ScopeDisplayMode::voltage || currentDisplayMode == ScopeDisplayMode::spectrum ||
+        currentDisplayMode == ScopeDisplayMode::record) && !hostAttached) return false;
+    uint32_t currentFrequency = getCurrentFrequency();
+    // A fixed timebase from the host, otherwise equivalent time for fast signals or one that shows a few periods
+    uint32_t sampleInterval = timebaseIntervalNs;
+    // The measurements and persistence need the samples in real time
+    if(sampleInterval == 0 && currentDisplayMode != ScopeDisplayMode::measure && persistenceFrames == PERSIST_OFF) sampleInterval = equivalentTimeInterval(currentFrequency);
+    if(sampleInterval == 0) sampleInterval = timebase.sampleIntervalFor(currentFrequency);
+    // The DMA engine sets the ADC clock divider from the interval. The divisor is for the timer engine,
+    // which takes the slow intervals and the fast ones if no DMA channel is free.
+    uint16_t divider = (sampleInterval + SAMPLE_RATE_US * 500) / (SAMPLE_RATE_US * 1000);
+    if(divider == 0) divider = 1;
+    // Peak detect and average reduce every timer reading into the samples, so they take whole ticks on the timer engine
+    bool decimate = acquireMode != acquireSample && divider >= DECIMATE_MIN_DIVISOR;
+    if(decimate) sampleInterval = divider * SAMPLE_RATE_US * 1000;
+    caps[currentSampleBuffer].divisor = divider;
+    caps[currentSampleBuffer].sampleIntervalNs = sampleInterval;
+    caps[currentSampleBuffer].preTriggerPercent = preTriggerPercent;
+    caps[currentSampleBuffer].trigger = triggerSettings;
+    caps[currentSampleBuffer].acquireMode = decimate? acquireMode: acquireSample;
+    caps[currentSampleBuffer].circular = decimate || sampleInterval > DMA_MAX_SAMPLE_INTERVAL_NS;   // Timer captures sample continuously until triggered
+    caps[currentSampleBuffer].sequence = frameSequence + 1;
+    captureInProgress = acquisition.requestCapture(&caps[currentSampleBuffer]);
+    if(!captureInProgress) return false;
+    frameSequence++;
+    if(captureArm == armSingle) captureArm = armStop;
+    return true;
 }
 
+// Equivalent time sampling for fast repetitive signals. Returns the sample interval, or 0 to sample in real time.
+uint32_t Scope::equivalentTimeInterval(uint32_t frequency)
+{
+    if(!equivalentTimeEnabled || timebaseIntervalNs != 0 || frequency < ETS_MIN_FREQUENCY || frequency > ETS_MAX_FREQUENCY)
+    {
+        equivalentTime.clear();
+        equivalentTimeIntervalNs = 0;
+        return 0;
+    }
+    // Start over when the signal changes by more than the edge counter's jitter
+    uint32_t milliHertz = equivalentTime.getMilliHertz();
+    uint32_t drift = (milliHertz > frequency * 1000)? milliHertz - frequency * 1000: frequency * 1000 - milliHertz;
+    if(milliHertz == 0 || drift > milliHertz / ETS_RESTART_DIVISOR) equivalentTime.begin(frequency * 1000, ADC_CLOCK_HZ);
+    // Rounded up so the DMA engine's conversion back to ADC clocks gives the same count
+    equivalentTimeIntervalNs = ((uint64_t)equivalentTime.getIntervalClocks() * 1000000000 + ADC_CLOCK_HZ - 1) / ADC_CLOCK_HZ;
+    return equivalentTimeIntervalNs;
+}
 
-bool Scope::startCaptureBasedOnFrequency()
+void Scope::displayVoltage()
 {
-    if(adcCapture->captureInProgress) return false; // Already capturing
-    uint16_t currentFrequency = getCurrentFrequency();
-    uint16_t divider;
-    if(currentFrequency <=1000) 
+    char buffer[16];
+    ssd1306_clear(&disp);
+    if(precisionCount == 0)
     {
-        if(currentFrequency <= 100)
-        {
-            if(currentFrequency <=10)
-            {
-                divider = 400;
-            }
-            else
-            {
-                divider = 40;
-            }
-        }
-        else
-        {
-            divider = 4;
-        }
+        // No precision readings (the ADC is streaming) - show the peak from the scope samples
+        formatFixed(buffer, getCurrentMillivolts(), 3, 1, " volts");
+        drawString(2, (DISPLAYHEIGHT - 16)/2, 2, buffer);
+        return;
+    }
+    // Mean of the readings since the last update, to the millivolt, and their peak
+    formatFixed(buffer, precisionToMillivolts((precisionSum + precisionCount / 2) / precisionCount), 3, 3, " V");
+    drawString(2, 0, 2, buffer);
+    formatFixed(buffer, precisionToMillivolts(precisionPeak), 3, 3, " V peak");
+    drawString(2, DISPLAYHEIGHT - 8, 1, buffer);
+    precisionSum = 0;
+    precisionCount = 0;
+    precisionPeak = 0;
+}
+void Scope::displayFrequency()
+{
+    char buffer[16];
+    uint32_t currentFrequency = getCurrentFrequency();
+    if(currentFrequency < 1000 && currentFrequency == frequencyMeasurement.hertz() && frequencyMeasurement.cycles > 0)
+    {
+        // Software counter reading - show as many decimals as the resolution supports
+        uint32_t resolution = frequencyMeasurement.resolutionMilliHertz;
+        uint8_t decimals = (resolution < 10)? 3: (resolution < 100)? 2: (resolution < 1000)? 1: 0;
+        formatFixed(buffer, frequencyMeasurement.milliHertz, 3, decimals, " Hz");
+    }
+    else if(currentFrequency < 1000)
+    {
+        formatFixed(buffer, currentFrequency, 0, 0, " Hz");
+    }
+    else if(currentFrequency < 1000000)
+    {
+        formatFixed(buffer, currentFrequency, 3, 2, " KHz");
     }
     else
     {
-        divider = 1;
+        formatFixed(buffer, currentFrequency, 6, 3, " MHz");
     }
-    caps[currentSampleBuffer].divisor = divider;
-    adcCapture->startCapture(&caps[currentSampleBuffer]);
-    return true;
+    ssd1306_clear(&disp);
+    drawString(2, (DISPLAYHEIGHT - 16)/2, 2, buffer);
 }
 
+// Measurements of the latest frame in two columns. Timings the frame had no edges for show as dashes.
+void Scope::displayMeasurements()
+{
+    char buffer[16];
+    char value[12];
+    ssd1306_clear(&disp);
+    if(measurements.samples == 0)
+    {
+        drawString(2, (DISPLAYHEIGHT - 8)/2, 1, "Measuring...");
+        return;
+    }
+    char *out = formatFixed(buffer, measurements.minimum, 3, 2, "-");
+    formatFixed(out + strlen(out), measurements.maximum, 3, 2, "V");
+    drawString(0, 0, 1, buffer);
+    drawString(66, 0, 1, "Vpp");
+    drawString(66 + 24, 0, 1, formatFixed(buffer, measurements.peakToPeak(), 3, 2, "V"));
+    drawString(0, 8, 1, "Avg");
+    drawString(24, 8, 1, formatFixed(buffer, measurements.mean, 3, 2, "V"));
+    drawString(66, 8, 1, "Rms");
+    drawString(66 + 24, 8, 1, formatFixed(buffer, measurements.rms, 3, 2, "V"));
+    drawString(0, 16, 1, "Duty");
+    drawString(30, 16, 1, (measurements.dutyPermille == 0)? "--": formatFixed(buffer, measurements.dutyPermille, 1, 1, "%"));
 
+    // Times in the same style as the timescale
+    const struct { const char *label; uint32_t ns; uint8_t x; uint8_t y; } times[] =
+    {
+        { "Pw", measurements.pulseWidthNs, 66, 16 },
+        { "Tr", measurements.riseNs, 0, 24 },
+        { "Tf", measurements.fallNs, 66, 24 }
+    };
+    for(auto &time : times)
+    {
+        drawString(time.x, time.y, 1, time.label);
+        if(time.ns == 0)
+        {
+            drawString(time.x + 18, time.y, 1, "--");
+            continue;
+        }
+        const char *unit = formatTimeSpan(value, time.ns);
+        strcpy(buffer, value);
+        strcat(buffer, unit);
+        drawString(time.x + 18, time.y, 1, buffer);
+    }
+}
 
-void Scope::displayVoltage()
+// Magnitude spectrum from DC at the left to half the sample rate at the right, with the peak frequency
+// and the span written on the side away from the peak
+void Scope::displaySpectrum()
 {
     char buffer[16];
     ssd1306_clear(&disp);
-    sprintf(buffer, "%.1f volts", getCurrentVoltage());
-    ssd1306_draw_string(&disp, 2, (DISPLAYHEIGHT - 16)/2, 2, buffer);
-    ssd1306_show(&disp);
+    if(currentSpectrum.getPoints() == 0)
+    {
+        drawString(2, (DISPLAYHEIGHT - 8)/2, 1, "Spectrum...");
+        return;
+    }
+    uint8_t heights[SPECTRUM_COLUMNS];
+    currentSpectrum.columnHeights(heights, SPECTRUM_COLUMNS, DISPLAYHEIGHT, SPECTRUM_DB_PER_PIXEL);
+    for(uint8_t column = 0; column < SPECTRUM_COLUMNS; column++)
+    {
+        if(heights[column] > 0) ssd1306_draw_vspan(&disp, column, DISPLAYHEIGHT - heights[column], DISPLAYHEIGHT - 1);
+    }
+
+    uint32_t peak = currentSpectrum.peakMilliHertz();
+    uint32_t span = currentSpectrum.getSpanHz();
+    bool right = (uint64_t)peak * 2 < (uint64_t)span * 1000;   // Peak in the left half
+    for(uint8_t line = 0; line < 2; line++)
+    {
+        if(line == 0 && peak < 1000000) formatFixed(buffer, peak, 3, 1, "Hz");
+        else if(line == 0) formatFixed(buffer, peak / 1000, 3, 2, "KHz");
+        else if(span < 1000) formatFixed(buffer, span, 0, 0, "Hz");
+        else formatFixed(buffer, span, 3, (span % 1000)? 1: 0, "KHz");
+        // On a blank patch so the bars don't run into the text
+        uint32_t width = strlen(buffer) * 6;
+        uint32_t x = right? SPECTRUM_COLUMNS - width: 0;
+        ssd1306_clear_square(&disp, right? x - 1: x, line * 8, width + 1, 8);
+        drawString(x, line * 8, 1, buffer);
+    }
 }
-void Scope::displayFrequency()
+
+// The deep record's view, with the time it spans and a bar showing where it is in the record
+void Scope::displayRecord()
 {
     char buffer[16];
-    uint16_t currentFrequency = getCurrentFrequency();
-    if(currentFrequency < 1000)
+    ssd1306_clear(&disp);
+    if(recordRequested || recording || deepRecord.getCount() == 0)
     {
-        sprintf(buffer, "%d Hz", currentFrequency);
+        uint32_t percent = recordRequested? 0: (uint64_t)deepRecord.getCount() * 100 / DEEP_RECORD_SAMPLES;
+        drawString(2, (DISPLAYHEIGHT - 8)/2, 1, "Recording");
+        drawString(2 + 60, (DISPLAYHEIGHT - 8)/2, 1, formatFixed(buffer, percent, 0, 0, "%"));
+        return;
     }
-    else
+    // Each column is a bar from the low to the high of its samples, stretched to meet the previous bar
+    uint8_t previousTop = 0;
+    uint8_t previousBottom = 0;
+    for(int16_t xpos = 0; xpos < DEEP_RECORD_COLUMNS; xpos++)
     {
-        float ffreq = currentFrequency;
-        sprintf(buffer, "%.2f KHz", ffreq/1000);
+        uint16_t low;
+        uint16_t high;
+        if(!deepRecord.column(xpos, low, high)) break;     // A record cut short
+        uint8_t top = capturedDataToYpos(high);     // The axis is inverted - the high is the top
+        uint8_t bottom = capturedDataToYpos(low);
+        uint8_t y1 = top;
+        uint8_t y2 = bottom;
+        if(xpos > 0 && y1 > previousBottom) y1 = previousBottom;
+        if(xpos > 0 && y2 < previousTop) y2 = previousTop;
+        ssd1306_draw_vspan(&disp, xpos, y1, y2);
+        previousTop = top;
+        previousBottom = bottom;
     }
-    ssd1306_clear(&disp);
-    ssd1306_draw_string(&disp, 2, (DISPLAYHEIGHT - 16)/2, 2, buffer);
-    ssd1306_show(&disp);
+    drawString(102, 0, 1, (deepRecord.getLostSamples() != 0)? "GAP": "REC");
+    drawTimescale((uint64_t)deepRecord.getSampleIntervalNs() * deepRecord.getViewSamples());
+    ssd1306_draw_empty_square(&disp, 102, DISPLAYHEIGHT - 6, 25, 5);
+    uint32_t position = (uint64_t)deepRecord.getViewStart() * 24 / DEEP_RECORD_SAMPLES;
+    uint32_t width = (uint64_t)deepRecord.getViewSamples() * 24 / DEEP_RECORD_SAMPLES;
+    ssd1306_draw_square(&disp, 103 + position, DISPLAYHEIGHT - 4, (width == 0)? 1: width, 2);
 }
 
+// Stream into the deep record at the interval the scope would show, so the deepest zoom is a normal screen
+bool Scope::startRecord()
+{
+    if(streaming || recording) return false;
+    uint32_t sampleInterval = (timebaseIntervalNs != 0)? timebaseIntervalNs: timebase.sampleIntervalFor(getCurrentFrequency());
+    if(sampleInterval < DMA_MIN_SAMPLE_INTERVAL_NS) sampleInterval = DMA_MIN_SAMPLE_INTERVAL_NS;
+    if(sampleInterval > DMA_MAX_SAMPLE_INTERVAL_NS) sampleInterval = DMA_MAX_SAMPLE_INTERVAL_NS;
+    // Whole ADC clocks, as the streamer will run it
+    uint32_t adcClocks = (uint64_t)sampleInterval * (ADC_CLOCK_HZ / 1000000) / 1000;
+    sampleInterval = adcClocks * 1000 / (ADC_CLOCK_HZ / 1000000);
+    if(!acquisition.requestStream(sampleInterval)) return false;
+    deepRecord.begin(sampleInterval);
+    recording = true;
+    return true;
+}
+
+void Scope::stopRecord()
+{
+    if(recording && acquisition.requestStream(0)) recording = false;
+}
+
+// Add a frame's trace to the persistence map
+void Scope::addToPersistence(CapturedData &cap)
+{
+    PROFILE_REGION(persistence);
+    // Traces on another timebase don't line up
+    if(cap.sampleIntervalNs != persistenceIntervalNs)
+    {
+        persistence.clear();
+        persistenceIntervalNs = cap.sampleIntervalNs;
+    }
+    uint8_t top[NUM_SAMPLES];
+    uint8_t bottom[NUM_SAMPLES];
+    uint8_t highest = DISPLAYHEIGHT;
+    uint8_t lowest = 0;
+    for(int16_t xpos = 0; xpos < NUM_SAMPLES; xpos++)
+    {
+        // The axis is inverted - the high is the top
+        top[xpos] = capturedDataToYpos((cap.acquireMode == acquirePeak)? cap.sampleAt(xpos): cap.alignedSampleAt(xpos));
+        bottom[xpos] = (cap.acquireMode == acquirePeak)? capturedDataToYpos(cap.lowAt(xpos)): top[xpos];
+        if(top[xpos] < highest) highest = top[xpos];
+        if(bottom[xpos] > lowest) lowest = bottom[xpos];
+    }
+    // An untriggered frame isn't lined up with the others. Only a flat one (DC) is worth keeping.
+    if(cap.triggerLocation < 0 && lowest - highest > 1) return;
+
+    // Each column spans its own high and low and reaches the previous column, as the trace is drawn
+    persistence.nextCapture();
+    for(int16_t xpos = 0; xpos < NUM_SAMPLES; xpos++)
+    {
+        uint8_t y1 = top[xpos];
+        uint8_t y2 = bottom[xpos];
+        if(xpos > 0 && y1 > bottom[xpos - 1]) y1 = bottom[xpos - 1];
+        if(xpos > 0 && y2 < top[xpos - 1]) y2 = top[xpos - 1];
+        persistence.addSpan(xpos, y1, y2);
+    }
+}
+
+void Scope::setPersistence(uint8_t frames)
+{
+    persistenceFrames = frames;
+    if(frames != PERSIST_OFF) persistence.setFrames(frames);
+    persistence.clear();
+    persistenceIntervalNs = 0;
+}
+
+// Timer ticks per sample if the scope should roll, otherwise 0. A host gets whole frames instead.
+uint16_t Scope::rollDivisorFor()
+{
+    if(!rollEnabled || currentDisplayMode != ScopeDisplayMode::scope || streaming || hostAttached || persistenceFrames != PERSIST_OFF) return 0;
+    uint32_t sampleInterval = (timebaseIntervalNs != 0)? timebaseIntervalNs: timebase.sampleIntervalFor(getCurrentFrequency());
+    if(sampleInterval < ROLL_MIN_INTERVAL_NS) return 0;
+    return (sampleInterval + SAMPLE_RATE_US * 500) / (SAMPLE_RATE_US * 1000);
+}
+
+// Start, stop or retime the roll to suit the timebase, and draw the samples core1 has taken since the last poll
+void Scope::updateRoll()
+{
+    uint16_t divisor = rollDivisorFor();
+    if(divisor != rollDivisor || (divisor != 0 && acquireMode != rollAcquireMode))
+    {
+        RollRequest request;
+        request.divisor = divisor;
+        request.acquireMode = acquireMode;
+        if(acquisition.requestRoll(request))
+        {
+            rollDivisor = divisor;
+            rollAcquireMode = acquireMode;
+            rollBuffer.clear();
+            if(divisor != 0) updateDisplay();   // Labels and an empty trace
+        }
+    }
+
+    RollSample sample;
+    bool drawn = false;
+    while(acquisition.getRollSample(sample))
+    {
+        if(rollDivisor == 0) continue;      // Left over from a roll that has stopped
+        PROFILE_REGION(roll);
+        uint16_t xpos = rollBuffer.add(sample);
+        eraseRollColumn(xpos);
+        drawRollColumn(xpos);
+        // Open the gap ahead of the cursor. At the right hand edge it is column 0, which the next sample redraws anyway -
+        // erasing it now would make this update span the whole trace.
+        if(rollBuffer.getGap() != 0) eraseRollColumn(rollBuffer.getGap());
+        drawn = true;
+    }
+    // Only the columns that changed go out. Samples that arrive while the panel is busy go with the next update.
+    if(drawn) flushDisplay();
+}
+
+// Clear one column of the trace area
+void Scope::eraseRollColumn(uint16_t xpos)
+{
+    for(uint8_t page = 0; page < DISPLAYHEIGHT / 8; page++) disp.buffer[page * disp.width + xpos] = 0;
+}
+
+// Draw the roll sample in one column as a bar from its low to its high, stretched to meet the column before
+void Scope::drawRollColumn(uint16_t xpos)
+{
+    if(!rollBuffer.filled(xpos)) return;
+    const RollSample &sample = rollBuffer.at(xpos);
+    uint8_t y1 = capturedDataToYpos(sample.value);      // The axis is inverted - the high is the top
+    uint8_t y2 = capturedDataToYpos(sample.low);
+    if(rollBuffer.filled(xpos - 1))
+    {
+        const RollSample &previous = rollBuffer.at(xpos - 1);
+        uint8_t previousTop = capturedDataToYpos(previous.value);
+        uint8_t previousBottom = capturedDataToYpos(previous.low);
+        if(y1 > previousBottom) y1 = previousBottom;
+        if(y2 < previousTop) y2 = previousTop;
+    }
+    ssd1306_draw_vspan(&disp, xpos, y1, y2);
+}
+
+// The whole rolling trace and its labels. Drawn when the roll starts - after that it is drawn a column at a time.
+void Scope::displayRoll()
+{
+    ssd1306_clear(&disp);
+    for(uint16_t xpos = 0; xpos < NUM_SAMPLES; xpos++) drawRollColumn(xpos);
+    drawString(102, 0, 1, "ROLL");
+    drawTimescale((uint64_t)rollDivisor * SAMPLE_RATE_US * 1000 * NUM_SAMPLES);
+    if(rollAcquireMode == acquirePeak) drawString(102, DISPLAYHEIGHT - 8, 1, "PK");
+    else if(rollAcquireMode == acquireAverage) drawString(102, DISPLAYHEIGHT - 8, 1, "AV");
+}
 
 void Scope::displayScope()
 {
-    if(!caps[currentDisplayBuffer].captureComplete) return;    // No data yet
-    uint16_t *dataptr = caps[currentDisplayBuffer].buffer;
+    if(rollDivisor != 0)
+    {
+        displayRoll();
+        return;
+    }
+
+    if(persistenceFrames != PERSIST_OFF)
+    {
+        // Every trace still on show, drawn from the map
+        ssd1306_clear(&disp);
+        persistence.render(disp.buffer, disp.width, DISPLAYHEIGHT);
+        if(!persistence.isEmpty()) drawTimescale((uint64_t)persistenceIntervalNs * NUM_SAMPLES);
+        drawString(102, DISPLAYHEIGHT - 8, 1, (persistenceFrames == PERSIST_FOREVER)? "INF": "PS");
+        return;
+    }
+
+    CapturedData &cap = caps[currentDisplayBuffer];
+    if(!cap.captureComplete) return;    // No data yet
 
     ssd1306_clear(&disp);
 
-    int16_t startpos = caps[currentDisplayBuffer].triggerLocation;
+    // Samples were taken off schedule (interrupts held off) - the time axis can't be trusted
+    if(cap.timingSuspect()) drawString(102, 0, 1, "late");
+
+    // A fast repetitive signal is shown as rebuilt from the equivalent time captures
+    if(equivalentTimeIntervalNs != 0 && equivalentTime.ready())
+    {
+        uint8_t trace[100];
+        uint16_t preTrigger = cap.preTriggerSamples();
+        for(int16_t xpos = 0; xpos< 100; xpos++) trace[xpos] = capturedDataToYpos(equivalentTime.sampleAt(xpos, preTrigger));
+        ssd1306_draw_trace(&disp, 0, trace, 100);
+        drawTimescale(equivalentTime.getSpanNs());
+        drawString(102, DISPLAYHEIGHT - 8, 1, "ET");
+        return;
+    }
+
+    bool triggered = cap.triggerLocation >= 0;
 
-    if(startpos<0)
+    if(!triggered)
     {
         // Is it DC?
-        uint16_t *chkptr = caps[currentDisplayBuffer].buffer;
         uint16_t minValue = 1024;
         uint16_t maxValue = 0;
-        for(int16_t xpos = 0; xpos< 100; xpos++, chkptr++)
+        for(int16_t xpos = 0; xpos< 100; xpos++)
         {
-            if(*chkptr < minValue) minValue = *chkptr;
-            if(*chkptr > maxValue) maxValue = *chkptr;
+            uint16_t value = cap.sampleAt(xpos);
+            if(cap.lowAt(xpos) < minValue) minValue = cap.lowAt(xpos);
+            if(value > maxValue) maxValue = value;
         }
         int16_t dif = capturedDataToYpos(minValue) - capturedDataToYpos(maxValue);  // Remember, axis is inverted, so Y for minValue is larger than Y for maxValue
-        if(dif > 1) startpos =0;   // If less than 1 pixel diff, consider it DC
+        if(dif > 1) triggered = true;   // If less than 1 pixel diff, consider it DC
     }
 
-    if(startpos== -1)
+    if(!triggered)
     {
         // DC voltage
-        uint16_t dcv = capturedDataToYpos(*dataptr);
+        uint16_t dcv = capturedDataToYpos(cap.sampleAt(0));
         ssd1306_draw_line(&disp, 0, dcv, 99, dcv);
-        ssd1306_draw_string(&disp, 102, (DISPLAYHEIGHT - 8)/2, 1, "DC" );
+        drawString(102, (DISPLAYHEIGHT - 8)/2, 1, "DC" );
     }
     else
     {
-        uint16_t endpos = startpos + 100;
-        int16_t previousY = -1;
-        dataptr += startpos;
-        for(int16_t xpos = 0; xpos< 100; xpos++)
+        // Samples are read in place - circular captures wrap at the end of the buffer
+        if(cap.acquireMode == acquirePeak)
+        {
+            // Each column is a bar from the low to the high of its interval, stretched to meet the previous bar
+            uint8_t previousTop = 0;
+            uint8_t previousBottom = 0;
+            for(int16_t xpos = 0; xpos< 100; xpos++)
+            {
+                uint8_t top = capturedDataToYpos(cap.sampleAt(xpos));     // The axis is inverted - the high is the top
+                uint8_t bottom = capturedDataToYpos(cap.lowAt(xpos));
+                uint8_t y1 = top;
+                uint8_t y2 = bottom;
+                if(xpos > 0 && y1 > previousBottom) y1 = previousBottom;
+                if(xpos > 0 && y2 < previousTop) y2 = previousTop;
+                ssd1306_draw_vspan(&disp, xpos, y1, y2);
+                previousTop = top;
+                previousBottom = bottom;
+            }
+            drawString(102, DISPLAYHEIGHT - 8, 1, "PK");
+        }
+        else
+        {
+            // Each column is drawn as a span from the previous sample, whole page bytes at a time.
+            // The trace is shifted by the trigger's sub-sample position so it holds still from frame to frame.
+            uint8_t trace[100];
+            for(int16_t xpos = 0; xpos< 100; xpos++) trace[xpos] = capturedDataToYpos(cap.alignedSampleAt(xpos));
+            ssd1306_draw_trace(&disp, 0, trace, 100);
+            if(cap.acquireMode == acquireAverage) drawString(102, DISPLAYHEIGHT - 8, 1, "AV");
+        }
+        drawTimescale((uint64_t)cap.sampleIntervalNs * NUM_SAMPLES);
+
+    }
+}
+
+void Scope::displayStreaming()
+{
+    char buffer[24];
+    ssd1306_clear(&disp);
+    drawString(0, 0, 1, acquisition.isStreaming()? "USB stream": "USB stream starting");
+    if(acquisition.isStreaming())
+    {
+        formatFixed(buffer, 1000000000 / acquisition.getStreamIntervalNs(), 3, 1, " kS/s");
+        drawString(0, 8, 1, buffer);
+    }
+    formatFixed(buffer, streamFramesSent, 0, 0, " frames");
+    drawString(0, 16, 1, buffer);
+    formatFixed(buffer, streamBlocksLost, 0, 0, " lost");
+    drawString(0, 24, 1, buffer);
+}
+
+bool Scope::startStreaming(uint32_t sampleIntervalNs)
+{
+    if(recording) return false;     // The deep record has the stream
+    if(!acquisition.requestStream(sampleIntervalNs)) return false;
+    streaming = true;
+    streamFramesSent = 0;
+    streamBlocksLost = 0;
+    return true;
+}
+
+bool Scope::stopStreaming()
+{
+    if(!streaming) return true;
+    if(!acquisition.requestStream(0)) return false;
+    streaming = false;
+    return true;
+}
+
+// Pack each block core1 has filled into a frame and send it. The block goes back to core1 as soon as
+// it is packed. Blocks that arrive after streaming stops are just returned.
+void Scope::sendStreamBlocks()
+{
+    PROFILE_REGION(streamSend);
+    StreamBlock *block;
+    while(acquisition.getStreamBlock(block))
+    {
+        // The deep record takes the blocks instead of USB. Samples core0 fell too far behind to record leave a gap.
+        if(recording && block->sampleCount != 0)
+        {
+            PROFILE_REGION(deepRecord);
+            deepRecord.addLost((uint32_t)block->lostBefore * STREAM_BLOCK_SAMPLES);
+            for(uint16_t index = 0; index < block->sampleCount; index++) deepRecord.append(block->samples[index] >> 2);    // 10 bits
+            acquisition.releaseStreamBlock(block);
+            continue;
+        }
+        streamBlocksLost += block->lostBefore;
+        if(!streaming || block->sampleCount == 0)
         {
-            uint16_t newY = capturedDataToYpos(*dataptr++);
-            if(previousY==-1 || previousY==newY)
+            acquisition.releaseStreamBlock(block);
+            continue;
+        }
+        StreamFrameHeader header;
+        header.magic = STREAM_MAGIC;
+        header.version = STREAM_VERSION;
+        header.format = STREAM_FORMAT_PACKED12;
+        header.sampleCount = block->sampleCount;
+        header.sequence = block->sequence;
+        header.sampleIntervalNs = acquisition.getStreamIntervalNs();
+        header.timestampUs = block->timestampUs;
+        memcpy(streamFrame, &header, sizeof(header));
+        uint32_t length = sizeof(header) + packSamples12(block->samples, block->sampleCount, streamFrame + sizeof(header));
+        acquisition.releaseStreamBlock(block);
+        stdio_put_string((const char *)streamFrame, length, false, false);    // Binary - no CR/LF translation
+        streamFramesSent++;
+    }
+}
+
+uint32_t Scope::setTimebase(uint32_t sampleIntervalNs)
+{
+    if(sampleIntervalNs != 0 && sampleIntervalNs <= DMA_MAX_SAMPLE_INTERVAL_NS)
+    {
+        // Whole ADC clocks, as the DMA engine will run it
+        if(sampleIntervalNs < DMA_MIN_SAMPLE_INTERVAL_NS) sampleIntervalNs = DMA_MIN_SAMPLE_INTERVAL_NS;
+        uint32_t adcClocks = (uint64_t)sampleIntervalNs * (ADC_CLOCK_HZ / 1000000) / 1000;
+        sampleIntervalNs = adcClocks * 1000 / (ADC_CLOCK_HZ / 1000000);
+    }
+    else if(sampleIntervalNs != 0)
+    {
+        // Whole timer ticks, as the timer engine will run it
+        uint32_t ticks = (sampleIntervalNs + SAMPLE_RATE_US * 500) / (SAMPLE_RATE_US * 1000);
+        if(ticks > UINT16_MAX) ticks = UINT16_MAX;
+        sampleIntervalNs = ticks * SAMPLE_RATE_US * 1000;
+    }
+    timebaseIntervalNs = sampleIntervalNs;
+    return sampleIntervalNs;
+}
+
+uint32_t Scope::arm(HostArmMode mode)
+{
+    captureArm = mode;
+    // Start the single capture now rather than when the frame on show has been used
+    if(mode == armSingle && currentDisplayBuffer >= 0) caps[currentDisplayBuffer].captureComplete = false;
+    return frameSequence + 1;
+}
+
+void Scope::textCommand(int command)
+{
+    switch(command)
+    {
+        case 's': startStreaming();
+        break;
+        case 'x': stopStreaming();
+        break;
+        case 'e': equivalentTimeEnabled = !equivalentTimeEnabled;
+        break;
+        case 'a': acquireMode = (acquireMode == acquireAverage)? acquireSample: (AcquireMode)(acquireMode + 1);
+        break;
+        case 'l': rollEnabled = !rollEnabled;
+        break;
+        // Zoom the deep record by two, or pan it half a screen
+        case '+':
+            if(recordOnShow() && deepRecord.getZoom() < DEEP_MAX_ZOOM)
             {
-                //printf("%d ", newY);
-                ssd1306_draw_pixel(&disp, xpos, newY);
+                deepRecord.setZoom(deepRecord.getZoom() + 1);
+                updateDisplay();
             }
-            else 
+        break;
+        case '-':
+            if(recordOnShow() && deepRecord.getZoom() > 0)
             {
-                //printf("%d - %d ",  previousY, newY);
-                if(previousY < newY) ssd1306_draw_line(&disp, xpos, previousY, xpos, newY);
-                else ssd1306_draw_line(&disp, xpos, newY, xpos, previousY);
+                deepRecord.setZoom(deepRecord.getZoom() - 1);
+                updateDisplay();
             }
-            previousY = newY;
+        break;
+        case '<':
+        case '>':
+            if(recordOnShow())
+            {
+                deepRecord.pan((command == '>')? DEEP_RECORD_COLUMNS / 2: -(DEEP_RECORD_COLUMNS / 2));
+                updateDisplay();
+            }
+        break;
+        case 'd': setPersistence((persistenceFrames == PERSIST_OFF)? PERSIST_DEFAULT_FRAMES: (persistenceFrames == PERSIST_FOREVER)? PERSIST_OFF: PERSIST_FOREVER);
+        break;
+#ifdef BITSCANNER_PROFILE
+        case 'p': Profiler::dump();
+        break;
+        case 'r': Profiler::reset();
+        break;
+#endif
+    }
+}
+
+// Hand over the frame on show. Taking it frees the buffer, so the next capture starts as soon as the
+// current one is done - a host fetching frames runs the captures as fast as it reads them.
+void Scope::frameResponse(HostResponse &response)
+{
+    CapturedData *frame = (currentDisplayBuffer >= 0)? &caps[currentDisplayBuffer]: NULL;
+    if(!frame || !frame->captureComplete)
+    {
+        response.begin(hostGetFrame, hostNotReady);
+        return;
+    }
+    bool triggered = frame->triggerLocation >= 0;
+    int16_t triggerIndex = -1;
+    if(triggered)
+    {
+        triggerIndex = frame->triggerLocation - frame->startLocation;
+        if(triggerIndex < 0) triggerIndex += CAPTURE_BUFFER_SIZE;
+    }
+    response.begin(hostGetFrame, hostOk);
+    response.put32(frame->sequence);
+    response.put32(frame->sampleIntervalNs);
+    response.put32(frame->endFrequency);
+    response.put16(triggerIndex);
+    uint8_t flags = (triggered? FRAME_FLAG_TRIGGERED: 0) | (frame->timingSuspect()? FRAME_FLAG_LATE: 0);
+    if(frame->acquireMode == acquirePeak) flags |= FRAME_FLAG_PEAK;
+    if(frame->acquireMode == acquireAverage) flags |= FRAME_FLAG_AVERAGE;
+    response.put8(flags);
+    response.put8(frame->triggerFraction);
+    response.put16(NUM_SAMPLES);
+    for(uint16_t x = 0; x < NUM_SAMPLES; x++) response.put16(frame->sampleAt(x));
+    if(frame->acquireMode == acquirePeak) for(uint16_t x = 0; x < NUM_SAMPLES; x++) response.put16(frame->lowAt(x));
+    frame->captureComplete = false;
+}
+
+void Scope::hostRequest(HostRequest &request)
+{
+    HostResponse response(hostResponse, sizeof(hostResponse));
+    static const uint8_t payloadLengths[] = { 0, 0, 4, 1, 1, 0, 0, 4, 1, 1 };  // By command
+    bool fullTrigger = request.command == hostSetTrigger && request.length == HOST_TRIGGER_PAYLOAD;
+    if(request.command == 0 || request.command > hostSetAcquire || (request.length != payloadLengths[request.command] && !fullTrigger))
+    {
+        response.begin(request.command, hostBadRequest);
+    }
+    else switch(request.command)
+    {
+        case hostPing:
+            response.begin(request.command, hostOk);
+            response.put8(HOST_PROTOCOL_VERSION);
+            response.put16(NUM_SAMPLES);
+            response.put16(CAPTURE_BUFFER_SIZE);
+            response.put16(SAMPLE_RATE_US);
+            response.put32(DMA_MIN_SAMPLE_INTERVAL_NS);
+        break;
+        case hostSetTimebase:
+            response.begin(request.command, hostOk);
+            response.put32(setTimebase(request.get32(0)));
+        break;
+        case hostSetTrigger:
+            if(fullTrigger)
+            {
+                TriggerSettings settings;
+                settings.level = (int16_t)request.get16(1);
+                settings.slope = (TriggerSlope)request.get8(3);
+                settings.hysteresis = request.get16(4);
+                if(settings.hysteresis < TRIGGER_MIN_HYSTERESIS) settings.hysteresis = TRIGGER_MIN_HYSTERESIS;
+                settings.holdoffUs = request.get32(6);
+                if(settings.level < TRIGGER_LEVEL_AUTO || settings.level >= ADC_CODES || settings.slope > triggerFalling)
+                {
+                    response.begin(request.command, hostBadRequest);
+                    break;
+                }
+                setTrigger(settings);
+            }
+            setPreTriggerPercent(request.get8(0));
+            response.begin(request.command, hostOk);
+        break;
+        case hostSetAcquire:
+            if(request.get8(0) > acquireAverage)
+            {
+                response.begin(request.command, hostBadRequest);
+                break;
+            }
+            setAcquireMode((AcquireMode)request.get8(0));
+            response.begin(request.command, hostOk);
+        break;
+        case hostArm:
+            if(request.get8(0) > armStop)
+            {
+                response.begin(request.command, hostBadRequest);
+                break;
+            }
+            response.begin(request.command, hostOk);
+            response.put32(arm((HostArmMode)request.get8(0)));
+        break;
+        case hostGetFrame:
+            frameResponse(response);
+        break;
+        case hostGetMeter:
+            response.begin(request.command, hostOk);
+            response.put32(getCurrentFrequency());
+            response.put32(frequencyMeasurement.milliHertz);
+            response.put32(frequencyMeasurement.resolutionMilliHertz);
+            response.put32(edgeFrequency);
+            response.put16(getMillivoltsFromADCValue(hostPeakADC));
+            response.put16(precisionToMillivolts(precisionMean));
+            response.put16(precisionToMillivolts(hostPrecisionPeak));
+            hostPeakADC = 0;
+            hostPrecisionPeak = 0;
+        break;
+        case hostStream:
+        {
+            uint32_t interval = request.get32(0);
+            bool accepted = (interval == 0)? stopStreaming(): startStreaming(interval);
+            response.begin(request.command, accepted? hostOk: hostBusy);
         }
-        const char *timescale1;
-        const char *timescale2;
-        switch(caps[currentDisplayBuffer].divisor)
+        break;
+        case hostProfile:
+#ifdef BITSCANNER_PROFILE
+            if(request.get8(0) == 0) Profiler::dump();
+            else Profiler::reset();
+            response.begin(request.command, hostOk);
+#else
+            response.begin(request.command, hostUnsupported);
+#endif
+        break;
+    }
+    stdio_put_string((const char *)hostResponse, response.finish(), false, false);
+}
+
+// Take what has arrived on USB, a bounded amount each poll so the display and meters keep going
+void Scope::pollHost()
+{
+    uint64_t now = time_us_64();
+    for(int count = 0; count < HOST_BYTES_PER_POLL; count++)
+    {
+        int input = getchar_timeout_us(0);
+        if(input == PICO_ERROR_TIMEOUT || input < 0) return;
+        switch(hostParser.feed(input, now))
         {
-            case 1: timescale1 = "2.5"; timescale2 = "ms";
+            case parseRequest:
+                hostAttached = true;
+                hostRequest(hostParser.request);
             break;
-            case 4: timescale1 = "10"; timescale2 = "ms";
+            case parseBadChecksum:
+            {
+                HostResponse response(hostResponse, sizeof(hostResponse));
+                response.begin(hostParser.request.command, hostBadChecksum);
+                stdio_put_string((const char *)hostResponse, response.finish(), false, false);
+            }
             break;
-            case 40: timescale1 = "100"; timescale2 = "ms";
+            case parseText:
+                textCommand(input);
             break;
-            case 400: timescale1 = "1"; timescale2 = "sec";
+            case parsePending:
             break;
         }
-        ssd1306_draw_string(&disp, 102, (DISPLAYHEIGHT - 16)/2, 1, timescale1 );
-        ssd1306_draw_string(&disp, 102, (DISPLAYHEIGHT - 16)/2 + 8, 1, timescale2 );
-
     }
-
-    ssd1306_show(&disp);
 }
 
 void Scope::toggleDisplayMode()
@@ -201,41 +855,173 @@ void Scope::toggleDisplayMode()
             currentDisplayMode = ScopeDisplayMode::frequency;
         break;
         case ScopeDisplayMode::frequency:
+            currentDisplayMode = ScopeDisplayMode::measure;
+        break;
+        case ScopeDisplayMode::measure:
+            currentDisplayMode = ScopeDisplayMode::spectrum;
+        break;
+        case ScopeDisplayMode::spectrum:
+            currentDisplayMode = ScopeDisplayMode::record;
+            recordRequested = true;
+        break;
+        case ScopeDisplayMode::record:
             currentDisplayMode = ScopeDisplayMode::scope;
+            recordRequested = false;
+            stopRecord();
         break;
     }
     updateDisplay();
 }
 
+// A short press pans a zoomed deep record half a screen on, and from the end back to the start.
+// Zoomed all the way out there is nowhere to pan, so it moves on to the next mode as always.
+void Scope::shortPress()
+{
+    if(recordOnShow() && deepRecord.getZoom() > 0)
+    {
+        if(deepRecord.atEnd()) deepRecord.pan(-(int32_t)DEEP_RECORD_SAMPLES);
+        else deepRecord.pan(DEEP_RECORD_COLUMNS / 2);
+        updateDisplay();
+        return;
+    }
+    toggleDisplayMode();
+}
+
+// A long press zooms the deep record in by two, and from the deepest zoom back out to the whole record.
+// Anywhere else it is just a press that was held a little long.
+void Scope::longPress()
+{
+    if(!recordOnShow())
+    {
+        shortPress();
+        return;
+    }
+    deepRecord.setZoom((deepRecord.getZoom() == DEEP_MAX_ZOOM)? 0: deepRecord.getZoom() + 1);
+    updateDisplay();
+}
+
+// Start sending the frame. If the previous one is still on the wire, poll sends it when the bus is free.
+void Scope::flushDisplay()
+{
+    PROFILE_REGION(displayFlush);
+    displayPending = !ssd1306_show_async(&disp);
+}
+
 void Scope::updateDisplay()
 {
-    printf("Updating display\n");
+    if(!streaming && !hostAttached) printf("Updating display\n");     // Text would corrupt the binary responses
     lastDisplayUpdate = time_us_64();
-    switch (currentDisplayMode)
     {
-        case ScopeDisplayMode::scope:
-            displayScope();
-        break;
-        case ScopeDisplayMode::voltage:
-            displayVoltage();
-        break;
-        case ScopeDisplayMode::frequency:
-            displayFrequency();
-        break;
+        PROFILE_REGION(render);
+        switch (currentDisplayMode)
+        {
+            case ScopeDisplayMode::scope:
+                if(streaming) displayStreaming();
+                else displayScope();
+            break;
+            case ScopeDisplayMode::voltage:
+                displayVoltage();
+            break;
+            case ScopeDisplayMode::frequency:
+                displayFrequency();
+            break;
+            case ScopeDisplayMode::measure:
+                displayMeasurements();
+            break;
+            case ScopeDisplayMode::spectrum:
+                displaySpectrum();
+            break;
+            case ScopeDisplayMode::record:
+                displayRecord();
+            break;
+        }
     }
+    flushDisplay();
 }
 
 void Scope::poll()
 {
+    PROFILE_REGION(pollLoop);
     uint64_t currentPollTime = time_us_64();    // Mark time of this loop
 
-    if(!adcCapture) adcCapture = new Capture(0);
-    if(!adcCapture)  return;
-    if(!adcCapture->getTimerOn()) adcCapture->startCapture(NULL);
+    if(!acquisition.isStarted()) acquisition.start();
+
+    pollHost();
+
+    // Stop streaming when the host goes away rather than filling a buffer nobody reads
+    if(streaming && !stdio_usb_connected()) stopStreaming();
+    sendStreamBlocks();
+
+    // Collect whatever core1 has finished since the last poll
+    MeterReading reading;
+    while(acquisition.getMeterReading(reading))
+    {
+        frequencyMeasurement = reading.frequency;
+        currentFrequency = reading.frequency.hertz();
+        edgeFrequency = reading.edgeFrequency;
+        if(reading.peakADC > peakADCSinceLastRequest) peakADCSinceLastRequest = reading.peakADC;
+        if(reading.peakADC > hostPeakADC) hostPeakADC = reading.peakADC;
+    }
+    PrecisionReading precision;
+    while(acquisition.getPrecisionReading(precision))
+    {
+        precisionRequested = false;
+        if(precision.count == 0) continue;
+        precisionMean = precision.mean;
+        precisionSum += precision.mean;
+        precisionCount++;
+        if(precision.peak > precisionPeak) precisionPeak = precision.peak;
+        if(precision.peak > hostPrecisionPeak) hostPrecisionPeak = precision.peak;
+    }
+    // The voltmeter takes precision readings while it is on show
+    if(currentDisplayMode == ScopeDisplayMode::voltage && !precisionRequested && currentPollTime - lastPrecisionRequest > PRECISIONUPDATEUS)
+    {
+        precisionRequested = acquisition.requestPrecisionReading();
+        lastPrecisionRequest = currentPollTime;
+    }
+    // The spectrum takes blocks of readings while it is on show, at a rate to suit the signal
+    if(currentDisplayMode == ScopeDisplayMode::spectrum && !spectrumRequested && currentPollTime - lastSpectrumRequest > SPECTRUMUPDATEUS)
+    {
+        spectrumBlock.points = SPECTRUM_POINTS;
+        spectrumBlock.sampleIntervalNs = spectrumIntervalFor(getCurrentFrequency());
+        spectrumRequested = acquisition.requestSpectrumBlock(&spectrumBlock);
+        lastSpectrumRequest = currentPollTime;
+    }
+    SpectrumBlock *block;
+    while(acquisition.getSpectrumBlock(block))
+    {
+        PROFILE_REGION(spectrum);
+        spectrumRequested = false;
+        currentSpectrum.compute(block->samples, block->points, block->sampleIntervalNs);
+    }
+    CapturedData *completedCapture;
+    while(acquisition.getCompletedCapture(completedCapture))
+    {
+        captureInProgress = false;
+        // Every equivalent time capture is folded in, whether or not it is displayed. DMA captures fill the buffer.
+        if(equivalentTimeIntervalNs != 0 && completedCapture->sampleIntervalNs == equivalentTimeIntervalNs &&
+            completedCapture->currentSample == CAPTURE_BUFFER_SIZE)
+        {
+            PROFILE_REGION(equivalentTime);
+            equivalentTime.addCapture(completedCapture->buffer, CAPTURE_BUFFER_SIZE);
+        }
+    }
+
     // Don't do anything else for 1.5 seconds after power up to allow time for initial frequency count to take place
     if(currentPollTime < 1500000LL) return;
 
-    if( !adcCapture->captureInProgress &&( currentDisplayBuffer == -1 || !caps[currentDisplayBuffer].captureComplete))
+    // The deep record starts once the frequency is known, and stops when it is full or no longer on show
+    if(recordRequested && startRecord()) recordRequested = false;
+    if(recording && (deepRecord.full() || currentDisplayMode != ScopeDisplayMode::record))
+    {
+        stopRecord();
+        if(!recording) updateDisplay();     // Show it straight away
+    }
+
+    // Slow timebases roll - the display follows every sample rather than waiting for frames
+    updateRoll();
+
+    if( !captureInProgress &&( currentDisplayBuffer == -1 || !caps[currentDisplayBuffer].captureComplete))
     {
         // We've completed a capture!  Or, we're doing the first capture
         currentDisplayBuffer = currentSampleBuffer;
@@ -243,14 +1029,36 @@ void Scope::poll()
         startCaptureBasedOnFrequency();     // Start the next capture
     }
 
-    if(currentDisplayMode == ScopeDisplayMode::scope  && (currentPollTime - lastDisplayUpdate) > SCOPEUPDATEUS && caps[currentDisplayBuffer].captureComplete)
+    // Persistence takes in every frame the same way, so it keeps up with the captures. A host gets the frames instead.
+    if(currentDisplayMode == ScopeDisplayMode::scope && persistenceFrames != PERSIST_OFF && !hostAttached && !streaming &&
+        currentDisplayBuffer >= 0 && caps[currentDisplayBuffer].captureComplete)
+    {
+        addToPersistence(caps[currentDisplayBuffer]);
+        caps[currentDisplayBuffer].captureComplete = false;
+    }
+
+    // Measure each frame once the next capture is under way, and free it for the one after
+    if(currentDisplayMode == ScopeDisplayMode::measure && currentDisplayBuffer >= 0 && caps[currentDisplayBuffer].captureComplete)
+    {
+        PROFILE_REGION(measurements);
+        measurements = measurementEngine.measure(caps[currentDisplayBuffer]);
+        caps[currentDisplayBuffer].captureComplete = false;
+    }
+
+    // Never wait for the display. Frames are drawn into the buffer while the previous one is still on the wire,
+    // and only sending them waits for the bus - the newest drawing goes out as soon as it is free.
+    if(displayPending && !ssd1306_busy(&disp)) flushDisplay();
+
+    if(currentDisplayMode == ScopeDisplayMode::scope  && (currentPollTime - lastDisplayUpdate) > SCOPEUPDATEUS &&
+        (caps[currentDisplayBuffer].captureComplete || (persistenceFrames != PERSIST_OFF && !streaming)))
     {
         updateDisplay();
         caps[currentDisplayBuffer].captureComplete = false;
     }
+    if(currentDisplayMode == ScopeDisplayMode::scope && streaming && (currentPollTime - lastDisplayUpdate) > SCOPEUPDATEUS) updateDisplay();
 
-    // Update voltage or frequency every 500ms
-    if( (currentDisplayMode == ScopeDisplayMode::voltage || currentDisplayMode == ScopeDisplayMode::frequency) && (currentPollTime - lastDisplayUpdate) > VORFUPDATEUS)
+    // Update voltage, frequency or measurements every 500ms
+    if( currentDisplayMode != ScopeDisplayMode::scope && (currentPollTime - lastDisplayUpdate) > VORFUPDATEUS)
     {
         updateDisplay();
     }
@@ -19,22 +19,38 @@
 #ifndef __SCOPE_H__
 #define __SCOPE_H__
 
-#include "Capture.h"
-
-
-// Adjust R1 and R2 to measured values if you wish to calibrate
-#define R1  15.0  // R1 used in voltage divider
-#define R2  27.0  // R2 used in voltage divider
+#include "Acquisition.h"
+#include "Readout.h"
+#include "Timebase.h"
+#include "EquivalentTime.h"
+#include "Measurements.h"
+#include "Spectrum.h"
+#include "Persistence.h"
+#include "Roll.h"
+#include "DeepRecord.h"
+#include "HostProtocol.h"
+
+// Above this the software counter can't keep up with the signal and the hardware edge counter is used
+#define SOFTWARE_FREQUENCY_LIMIT 10000
 
 #define DISPLAYHEIGHT 32
 #define SCOPEUPDATEUS   500000LL
 #define VORFUPDATEUS    500000LL
+#define STREAM_DEFAULT_INTERVAL_NS  DMA_MIN_SAMPLE_INTERVAL_NS  // Stream at the ADC's full 500 kS/s
+#define HOST_BYTES_PER_POLL 64      // Most request bytes taken from USB in one poll
+#define PRECISIONUPDATEUS   100000LL    // How often the voltmeter asks core1 for a precision reading
+#define SPECTRUMUPDATEUS    250000LL    // How often the spectrum asks core1 for a block of readings
+#define SPECTRUM_POINTS     512         // Readings in each spectrum block - 2 bins to a column
+#define SPECTRUM_DB_PER_PIXEL 2
 
 enum ScopeDisplayMode
 {
     scope,
     voltage,
-    frequency
+    frequency,
+    measure,
+    spectrum,
+    record
 };
 
 
@@ -46,12 +62,41 @@ class Scope
 
         void poll();
 
-        uint16_t getCurrentFrequency();
+        uint32_t getCurrentFrequency();
 
-        float getCurrentVoltage();
+        uint16_t getCurrentMillivolts();
 
         ScopeDisplayMode getDisplayMode() { return currentDisplayMode; }
+        void setPreTriggerPercent(uint8_t percent) { preTriggerPercent = (percent > 100)? 100: percent; }   // Trigger position on the display (0 - 100%)
+        // Trigger level, slope, hysteresis and holdoff for the captures that follow
+        void setTrigger(const TriggerSettings &settings) { triggerSettings = settings; }
+        TriggerSettings getTrigger() { return triggerSettings; }
+        // Fixed sample interval, or 0 to choose it from the signal frequency. Returns the interval that will be used.
+        uint32_t setTimebase(uint32_t sampleIntervalNs);
+        // Capture continuously, capture one more frame, or stop. Returns the sequence number of the next frame.
+        uint32_t arm(HostArmMode mode);
+        // Sample, peak detect or average the readings the timer engine takes between samples
+        void setAcquireMode(AcquireMode mode) { acquireMode = mode; }
+        AcquireMode getAcquireMode() { return acquireMode; }
+        // Keep each scope trace on show for this many captures (PERSIST_FOREVER to keep them all), or PERSIST_OFF
+        void setPersistence(uint8_t frames);
+        uint8_t getPersistence() { return persistenceFrames; }
+        // Draw slow timebases a sample at a time (see Roll.h) rather than wait for whole frames
+        void setRollEnabled(bool enabled) { rollEnabled = enabled; }
+        bool getRollEnabled() { return rollEnabled; }
         void toggleDisplayMode();               // Toggle display mode among the options (switch hit)
+        // The switch. A short press toggles the display mode, or pans a zoomed deep record. A long press zooms a finished
+        // deep record, and anywhere else does what a short press does.
+        void shortPress();
+        void longPress();
+
+        // Stream raw samples over USB (see StreamFrame.h). Scope captures pause while streaming; the meters keep running.
+        // Both return false if core1 can't take the request yet.
+        bool startStreaming(uint32_t sampleIntervalNs = STREAM_DEFAULT_INTERVAL_NS);
+        bool stopStreaming();
+        bool isStreaming() { return streaming; }
+        uint32_t getStreamFramesSent() { return streamFramesSent; }
+        uint32_t getStreamBlocksLost() { return streamBlocksLost; }
 
 
     private:
@@ -61,11 +106,56 @@ class Scope
         CapturedData caps[2];
 
         ScopeDisplayMode currentDisplayMode = scope;    // Display mode shown on the current screen ( to support fast switching )
-
-        Capture *adcCapture = NULL;
-        float topOfRange = 3.3 * (R1 + R2) / R2;    // Measured top of range based on voltage divider
-
-        float getVoltageFromADCValue(uint16_t adcvalue);
+        TriggerSettings triggerSettings;
+        uint8_t preTriggerPercent = 10;             // Show a little history before the trigger
+
+        Acquisition acquisition;                // Capture engine running on core1
+        bool captureInProgress = false;         // A frame is with core1
+        uint32_t currentFrequency = 0;          // Latest software counter frequency from core1
+        FrequencyMeasurement frequencyMeasurement;  // The same reading with its resolution
+        uint32_t edgeFrequency = 0;             // Latest hardware edge counter frequency from core1
+        uint16_t peakADCSinceLastRequest = 0;   // Peak of the readings from core1 since the last voltage request
+        bool streaming = false;                 // Streaming has been requested
+        uint32_t streamFramesSent = 0;
+        uint32_t streamBlocksLost = 0;          // Blocks core1 had to drop because USB fell behind
+
+        uint32_t timebaseIntervalNs = 0;        // Fixed sample interval, 0 to follow the signal
+        Timebase timebase;                      // Follows the signal when there is no fixed interval
+        bool equivalentTimeEnabled = true;      // Rebuild fast repetitive signals from many captures
+        uint32_t equivalentTimeIntervalNs = 0;  // Sample interval of the equivalent time captures, 0 when sampling in real time
+        HostArmMode captureArm = armContinuous;
+        AcquireMode acquireMode = acquireSample;
+        uint32_t frameSequence = 0;             // Sequence number of the last capture requested
+        HostRequestParser hostParser;
+        bool hostAttached = false;              // A binary request has arrived - keep text off the port
+        uint16_t hostPeakADC = 0;               // Peak since the host last read the meter
+
+        bool precisionRequested = false;        // A precision reading is on its way from core1
+        uint64_t lastPrecisionRequest = 0;
+        uint32_t precisionSum = 0;              // Means of the precision readings since the voltmeter was last drawn
+        uint16_t precisionCount = 0;
+        uint16_t precisionPeak = 0;             // 14 bit peak since the voltmeter was last drawn
+        uint16_t precisionMean = 0;             // Latest 14 bit mean, 0 if none
+        uint16_t hostPrecisionPeak = 0;         // 14 bit peak since the host last read the meter
+
+        MeasurementEngine measurementEngine;    // Measures every frame while the measurements are on show
+        WaveformMeasurements measurements;      // From the latest frame
+
+        uint8_t persistenceFrames = PERSIST_OFF;    // How long the scope traces stay on show
+        uint32_t persistenceIntervalNs = 0;     // Sample interval of the traces on show
+
+        bool rollEnabled = true;
+        uint16_t rollDivisor = 0;               // Timer ticks per roll sample, 0 when not rolling
+        AcquireMode rollAcquireMode = acquireSample;
+        RollBuffer rollBuffer;                  // Samples on show while rolling
+
+        bool recordRequested = false;           // Start a deep record once the stream is free
+        bool recording = false;                 // The stream is filling the deep record
+
+        bool spectrumRequested = false;         // A spectrum block is with core1
+        uint64_t lastSpectrumRequest = 0;
+
+        uint16_t getMillivoltsFromADCValue(uint16_t adcvalue) { return adcToMillivolts(adcvalue); }
 
         // Scale to display height. Scale value is averaged when divided
         inline uint16_t capturedDataToYpos(uint16_t capturedData)
@@ -76,12 +166,34 @@ class Scope
         }
 
         bool startCaptureBasedOnFrequency();
+        uint32_t equivalentTimeInterval(uint32_t frequency);
         void updateDisplay();
+        void flushDisplay();
         void displayVoltage();
         void displayFrequency();
+        void displayMeasurements();
+        void displaySpectrum();
+        void displayRecord();
+        bool startRecord();
+        // A finished deep record is on show to zoom and pan
+        bool recordOnShow() { return currentDisplayMode == ScopeDisplayMode::record && !recordRequested && !recording; }
+        void stopRecord();
         void displayScope();
+        void addToPersistence(CapturedData &cap);
+        uint16_t rollDivisorFor();
+        void updateRoll();
+        void displayRoll();
+        void drawRollColumn(uint16_t xpos);
+        void eraseRollColumn(uint16_t xpos);
+        void displayStreaming();
+        void sendStreamBlocks();
+        void pollHost();
+        void textCommand(int command);
+        void hostRequest(HostRequest &request);
+        void frameResponse(HostResponse &response);
 
         uint64_t lastDisplayUpdate = 0;
+        bool displayPending = false;            // A frame was drawn while the previous one was still being sent
 
 };
 
@@ -0,0 +1,307 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __SPECTRUM_H__
+#define __SPECTRUM_H__
+
+// Spectrum analyzer. A block of 12 bit readings has its mean removed, a Hann window applied, and goes through
+// an in-place radix-2 FFT in Q15 fixed point - the RP2040 has no FPU, but its single cycle multiplier makes
+// 16 x 16 bit products cheap. The block is in block floating point: the input is scaled up to fill the
+// headroom, and a stage halves its outputs only when its inputs are big enough to overflow, so small
+// signals keep their precision. The twiddle factors come from a quarter wave sine table built at compile time.
+// Blocks of 256 to 1024 points are supported, and all the working storage is in the Spectrum object.
+// host/FftBench.cpp checks it against a double precision FFT.
+
+#include <stdint.h>
+
+#define SPECTRUM_MIN_BITS       8
+#define SPECTRUM_MAX_BITS       10
+#define SPECTRUM_MAX_POINTS     (1 << SPECTRUM_MAX_BITS)
+#define SPECTRUM_SINE_QUARTER   (SPECTRUM_MAX_POINTS / 4)
+#define SPECTRUM_INPUT_LIMIT    16384   // Input is scaled up to just under this
+#define SPECTRUM_HEADROOM       8192    // A stage with inputs this big or bigger halves its outputs
+#define SPECTRUM_INPUT_SHIFT    3       // A full scale reading is SPECTRUM_INPUT_LIMIT either side of the mean
+#define SPECTRUM_FULL_SCALE_LOG2 24     // Power of a full scale sine's bin: 1/N scaled, a quarter of Q15 full scale, squared
+#define SPECTRUM_SKIP_BINS      2       // Bins next to DC that the window spreads what's left of the mean into
+#define SPECTRUM_COLUMNS        128     // Display columns
+
+// A block of readings for the spectrum, passed to core1 to fill like a CapturedData frame
+typedef struct SpectrumBlockStruct
+{
+    uint16_t samples[SPECTRUM_MAX_POINTS];  // 12 bit readings
+    uint16_t points = 0;                    // A power of two, or 0 if the block couldn't be taken
+    uint32_t sampleIntervalNs = 0;
+} SpectrumBlock;
+
+struct SineTable
+{
+    int16_t sine[SPECTRUM_SINE_QUARTER + 1];
+};
+
+// Taylor series - the standard library's sine can't run at compile time
+constexpr double quarterSine(double angle)
+{
+    double term = angle;
+    double sum = angle;
+    for(int n = 1; n < 12; n++)
+    {
+        term *= -angle * angle / ((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr SineTable makeSineTable()
+{
+    SineTable table = {};
+    constexpr double PI = 3.14159265358979323846;
+    for(int index = 0; index <= SPECTRUM_SINE_QUARTER; index++)
+    {
+        double value = quarterSine(PI / 2 * index / SPECTRUM_SINE_QUARTER) * 32768;
+        table.sine[index] = (value >= 32767)? 32767: (int16_t)(value + 0.5);
+    }
+    return table;
+}
+
+inline constexpr SineTable spectrumSine = makeSineTable();
+
+// Sine of 2 pi index / SPECTRUM_MAX_POINTS in Q15
+inline int16_t sineQ15(uint16_t index)
+{
+    index &= SPECTRUM_MAX_POINTS - 1;
+    uint16_t quadrant = index / SPECTRUM_SINE_QUARTER;
+    uint16_t offset = index % SPECTRUM_SINE_QUARTER;
+    switch(quadrant)
+    {
+        case 0: return spectrumSine.sine[offset];
+        case 1: return spectrumSine.sine[SPECTRUM_SINE_QUARTER - offset];
+        case 2: return -spectrumSine.sine[offset];
+        default: return -spectrumSine.sine[SPECTRUM_SINE_QUARTER - offset];
+    }
+}
+
+inline int16_t cosineQ15(uint16_t index) { return sineQ15(index + SPECTRUM_SINE_QUARTER); }
+
+// Q15 product, rounded
+inline int32_t multiplyQ15(int32_t a, int32_t b) { return (a * b + (1 << 14)) >> 15; }
+
+inline uint32_t magnitudeQ15(int32_t value) { return (value < 0)? -value: value; }
+
+// In-place forward FFT of 2^bits points (SPECTRUM_MIN_BITS to SPECTRUM_MAX_BITS). Inputs must be within
+// +/-32767. Returns the number of stages that halved their outputs: the result is the transform divided
+// by 2 to that power. Each butterfly can at most grow its largest part by 1 + sqrt(2), so a stage whose
+// inputs are all under SPECTRUM_HEADROOM can't overflow.
+inline uint8_t fftQ15(int16_t *re, int16_t *im, uint8_t bits)
+{
+    uint16_t points = 1 << bits;
+    uint32_t largest = 0;       // Every part ORed together - only the top bit matters
+    for(uint16_t index = 0; index < points; index++) largest |= magnitudeQ15(re[index]) | magnitudeQ15(im[index]);
+
+    // Bit reversed order, so the butterflies can work in place
+    for(uint16_t index = 1, reversed = 0; index < points; index++)
+    {
+        uint16_t bit = points >> 1;
+        for(; reversed & bit; bit >>= 1) reversed ^= bit;
+        reversed |= bit;
+        if(index < reversed)
+        {
+            int16_t swap = re[index];
+            re[index] = re[reversed];
+            re[reversed] = swap;
+            swap = im[index];
+            im[index] = im[reversed];
+            im[reversed] = swap;
+        }
+    }
+
+    uint8_t halved = 0;
+    for(uint16_t size = 2; size <= points; size <<= 1)
+    {
+        uint8_t shift = (largest >= SPECTRUM_HEADROOM)? 1: 0;
+        halved += shift;
+        largest = 0;
+        uint16_t half = size >> 1;
+        uint16_t stride = SPECTRUM_MAX_POINTS / size;
+        for(uint16_t k = 0; k < half; k++)
+        {
+            // e^(-j 2 pi k / size)
+            int32_t wr = cosineQ15(k * stride);
+            int32_t wi = -sineQ15(k * stride);
+            for(uint16_t top = k; top < points; top += size)
+            {
+                uint16_t bottom = top + half;
+                // Rounded once for each part. The parts are under 2^15 * (1 + sqrt(2)), so the sums fit.
+                int32_t tr = (wr * re[bottom] - wi * im[bottom] + (1 << 14)) >> 15;
+                int32_t ti = (wr * im[bottom] + wi * re[bottom] + (1 << 14)) >> 15;
+                int32_t ur = re[top];
+                int32_t ui = im[top];
+                // Rounded when halving
+                re[top] = (ur + tr + shift) >> shift;
+                im[top] = (ui + ti + shift) >> shift;
+                re[bottom] = (ur - tr + shift) >> shift;
+                im[bottom] = (ui - ti + shift) >> shift;
+                largest |= magnitudeQ15(re[top]) | magnitudeQ15(im[top]) | magnitudeQ15(re[bottom]) | magnitudeQ15(im[bottom]);
+            }
+        }
+    }
+    return halved;
+}
+
+// log2 in 1/256ths. The fraction is a quadratic fit to log2(1 + x), good to about 0.01.
+inline int32_t log2Q8(uint32_t value)
+{
+    if(value == 0) return 0;
+    uint8_t topBit = 31 - __builtin_clz(value);
+    uint32_t fraction = (topBit >= 8)? (value >> (topBit - 8)) & 0xFF: (value << (8 - topBit)) & 0xFF;
+    return topBit * 256 + fraction + ((fraction * (256 - fraction) * 87) >> 16);
+}
+
+class Spectrum
+{
+    public:
+        // Window and transform points (a power of two from 256 to 1024) readings taken sampleIntervalNs apart.
+        // Returns false if the block can't be transformed.
+        bool compute(const uint16_t *samples, uint16_t points, uint32_t sampleIntervalNs)
+        {
+            bits = 0;
+            while((1u << bits) < points) bits++;
+            if(bits < SPECTRUM_MIN_BITS || bits > SPECTRUM_MAX_BITS || (1u << bits) != points || sampleIntervalNs == 0)
+            {
+                count = 0;
+                return false;
+            }
+            count = points;
+            intervalNs = sampleIntervalNs;
+
+            uint32_t sum = 0;
+            for(uint16_t index = 0; index < points; index++) sum += samples[index] & 0x0FFF;
+            int32_t mean = (sum + points / 2) >> bits;
+            uint32_t largest = 0;
+            for(uint16_t index = 0; index < points; index++) largest |= magnitudeQ15((int32_t)(samples[index] & 0x0FFF) - mean);
+            uint8_t inputShift = 0;
+            while(largest != 0 && (largest << (inputShift + 1)) < SPECTRUM_INPUT_LIMIT) inputShift++;
+
+            uint16_t stride = SPECTRUM_MAX_POINTS / points;
+            for(uint16_t index = 0; index < points; index++)
+            {
+                // Hann window: (1 - cos) / 2
+                int32_t window = (32768 - cosineQ15(index * stride)) >> 1;
+                int32_t value = ((int32_t)(samples[index] & 0x0FFF) - mean) << inputShift;
+                re[index] = multiplyQ15(value, window);
+                im[index] = 0;
+            }
+            uint8_t halved = fftQ15(re, im, bits);
+            // Back to the scale of a 1/N transform of readings shifted by SPECTRUM_INPUT_SHIFT
+            exponent = halved - bits + SPECTRUM_INPUT_SHIFT - inputShift;
+            return true;
+        }
+
+        uint16_t getPoints() { return count; }
+        uint16_t getBins() { return count / 2; }
+
+        // The transform, which is re + j im times 2 to the exponent. A full scale sine's bin is about SPECTRUM_INPUT_LIMIT / 4.
+        const int16_t *getReal() { return re; }
+        const int16_t *getImaginary() { return im; }
+        int8_t getExponent() { return exponent; }
+
+        // Frequency at the top of the spectrum, half the sample rate
+        uint32_t getSpanHz() { return (intervalNs == 0)? 0: 500000000 / intervalNs; }
+
+
+        // Column heights in pixels, dbPerPixel decibels a pixel down from a full scale sine. Each column shows
+        // the highest of the bins it covers so narrow peaks aren't lost.
+        void columnHeights(uint8_t *heights, uint16_t columns, uint8_t height, uint8_t dbPerPixel)
+        {
+            uint16_t bins = getBins();
+            for(uint16_t column = 0; column < columns; column++)
+            {
+                uint16_t first = (uint32_t)column * bins / columns;
+                uint16_t last = (uint32_t)(column + 1) * bins / columns;
+                if(last <= first) last = first + 1;
+                if(first < SPECTRUM_SKIP_BINS) first = SPECTRUM_SKIP_BINS;
+                uint32_t highest = 0;
+                for(uint16_t bin = first; bin < last && bin < bins; bin++)
+                {
+                    uint32_t binPower = power(bin);
+                    if(binPower > highest) highest = binPower;
+                }
+                // 10 log10(2) = 3.0103 dB a bit, and log2Q8 has 256 to the bit
+                int32_t level = log2Q8(highest) + exponent * 512;
+                int32_t belowFullScale = (SPECTRUM_FULL_SCALE_LOG2 * 256 - level) * 30103 / (256 * 10000);
+                int32_t pixels = (highest == 0)? 0: height - belowFullScale / dbPerPixel;
+                heights[column] = (pixels < 0)? 0: (pixels > height)? height: pixels;
+            }
+        }
+
+        // Frequency of the strongest bin in mHz, interpolated between its neighbours. 0 if there is no spectrum.
+        uint32_t peakMilliHertz()
+        {
+            uint16_t bins = getBins();
+            if(bins <= SPECTRUM_SKIP_BINS + 1) return 0;
+            uint16_t peak = SPECTRUM_SKIP_BINS;
+            for(uint16_t bin = SPECTRUM_SKIP_BINS + 1; bin < bins - 1; bin++)
+            {
+                if(power(bin) > power(peak)) peak = bin;
+            }
+            if(power(peak) == 0) return 0;
+            // A parabola through the logs of the peak and its neighbours fits a Hann windowed peak closely
+            int32_t before = log2Q8(power(peak - 1));
+            int32_t at = log2Q8(power(peak));
+            int32_t after = log2Q8(power(peak + 1));
+            int32_t curve = before - 2 * at + after;
+            int32_t offset = (curve < 0)? 128 * (before - after) / curve: 0;     // 256ths of a bin
+            if(offset > 128) offset = 128;
+            if(offset < -128) offset = -128;
+            uint64_t position = (uint64_t)peak * 256 + offset;
+            return position * 1000000000000ULL / ((uint64_t)count * intervalNs * 256);
+        }
+
+    private:
+        // Magnitude squared of a bin, before the block's scaling
+        uint32_t power(uint16_t bin) { return (int32_t)re[bin] * re[bin] + (int32_t)im[bin] * im[bin]; }
+
+        int16_t re[SPECTRUM_MAX_POINTS];
+        int16_t im[SPECTRUM_MAX_POINTS];
+        uint16_t count = 0;
+        uint8_t bits = 0;
+        int8_t exponent = 0;        // The power of 2 the bins are to be multiplied by
+        uint32_t intervalNs = 0;
+};
+
+// Sample interval for a spectrum wide enough to show a few harmonics of frequencyHz. The spans (half the
+// sample rate) step 1, 2.5, 5 per decade, and every one is a whole number of ADC clocks. Zero gives the widest.
+inline uint32_t spectrumIntervalFor(uint32_t frequencyHz)
+{
+    static const uint32_t spans[] = { 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000 };
+    uint32_t wanted = frequencyHz * 5;
+    uint32_t span = spans[sizeof(spans) / sizeof(spans[0]) - 1];
+    if(frequencyHz != 0)
+    {
+        for(uint32_t candidate : spans)
+        {
+            if(candidate >= wanted)
+            {
+                span = candidate;
+                break;
+            }
+        }
+    }
+    return 500000000 / span;
+}
+
+#endif
@@ -0,0 +1,65 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __SPSCQUEUE_H__
+#define __SPSCQUEUE_H__
+
+// Lock-free single producer / single consumer queue used to pass data between the two cores.
+// Only one core may push and only one core may pop. Neither side ever waits - push fails when
+// the queue is full and pop fails when it is empty.
+// host/SpscQueueTest.cpp stresses it with two threads.
+
+#include <stdint.h>
+#include <atomic>
+
+template <typename T, uint16_t SIZE>
+class SpscQueue
+{
+    static_assert(SIZE >= 2 && (SIZE & (SIZE - 1)) == 0, "SpscQueue size must be a power of two");
+
+    public:
+        // Producer side. Returns false if the queue is full.
+        bool push(const T &item)
+        {
+            uint16_t currentHead = head.load(std::memory_order_relaxed);
+            if((uint16_t)(currentHead - tail.load(std::memory_order_acquire)) >= SIZE) return false;
+            items[currentHead & (SIZE - 1)] = item;
+            head.store(currentHead + 1, std::memory_order_release);     // Publishes the item to the consumer
+            return true;
+        }
+
+        // Consumer side. Returns false if the queue is empty.
+        bool pop(T &item)
+        {
+            uint16_t currentTail = tail.load(std::memory_order_relaxed);
+            if(currentTail == head.load(std::memory_order_acquire)) return false;
+            item = items[currentTail & (SIZE - 1)];
+            tail.store(currentTail + 1, std::memory_order_release);     // Returns the slot to the producer
+            return true;
+        }
+
+        bool empty() { return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire); }
+        bool full() { return (uint16_t)(head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire)) >= SIZE; }
+
+    private:
+        T items[SIZE];
+        std::atomic<uint16_t> head{0};     // Next slot to write. Only changed by the producer.
+        std::atomic<uint16_t> tail{0};     // Next slot to read. Only changed by the consumer.
+};
+
+#endif
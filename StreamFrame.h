@@ -0,0 +1,91 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __STREAMFRAME_H__
+#define __STREAMFRAME_H__
+
+// Wire format of the USB sample stream. Each block of ADC samples is sent as a header followed by the
+// samples packed two to three bytes. Everything is little endian.
+// The sequence number counts blocks from the start of the stream, so a gap means blocks were lost -
+// either on the device because USB fell behind, or on the host. The timestamp is derived from the
+// sample count rather than read when the block arrives, so it is exact however late the block is sent.
+// This file has no Pico SDK dependencies so the host tools can use it.
+
+#include <stdint.h>
+
+#define STREAM_MAGIC            0x52545342      // "BSTR"
+#define STREAM_VERSION          1
+#define STREAM_FORMAT_PACKED12  1               // Two 12 bit samples in three bytes
+#define STREAM_BLOCK_SAMPLES    1024            // Samples in each frame. Must be even.
+#define STREAM_MAX_PAYLOAD      (STREAM_BLOCK_SAMPLES * 3 / 2)
+
+typedef struct StreamFrameHeaderStruct
+{
+    uint32_t magic;             // STREAM_MAGIC - marks the start of a frame
+    uint8_t version;            // STREAM_VERSION
+    uint8_t format;             // STREAM_FORMAT_PACKED12
+    uint16_t sampleCount;       // Samples in this frame
+    uint32_t sequence;          // Block number since the stream started
+    uint32_t sampleIntervalNs;  // Time between samples
+    uint64_t timestampUs;       // Device time of the first sample
+} StreamFrameHeader;
+
+static_assert(sizeof(StreamFrameHeader) == 24, "StreamFrameHeader must match the wire format");
+
+// Bytes of payload for count samples
+inline uint32_t packedSize(uint32_t count)
+{
+    return (count * 3 + 1) / 2;
+}
+
+// Pack 12 bit samples two to three bytes: the low byte of the first, then the high nibble of the first
+// with the low nibble of the second, then the high byte of the second. Returns the bytes written.
+inline uint32_t packSamples12(const uint16_t *samples, uint32_t count, uint8_t *out)
+{
+    uint8_t *start = out;
+    uint32_t index = 0;
+    for(; index + 1 < count; index += 2)
+    {
+        uint16_t first = samples[index] & 0xFFF;
+        uint16_t second = samples[index + 1] & 0xFFF;
+        *out++ = first;
+        *out++ = (first >> 8) | (second << 4);
+        *out++ = second >> 4;
+    }
+    if(index < count)
+    {
+        uint16_t last = samples[index] & 0xFFF;
+        *out++ = last;
+        *out++ = last >> 8;
+    }
+    return out - start;
+}
+
+inline void unpackSamples12(const uint8_t *in, uint32_t count, uint16_t *samples)
+{
+    uint32_t index = 0;
+    for(; index + 1 < count; index += 2)
+    {
+        samples[index] = in[0] | ((in[1] & 0x0F) << 8);
+        samples[index + 1] = (in[1] >> 4) | (in[2] << 4);
+        in += 3;
+    }
+    if(index < count) samples[index] = in[0] | ((in[1] & 0x0F) << 8);
+}
+
+#endif
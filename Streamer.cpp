@@ -0,0 +1,158 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Streamer.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "Profiler.h"
+
+static_assert((1 << STREAM_RING_BITS) == STREAM_BLOCK_SAMPLES * sizeof(uint16_t), "STREAM_RING_BITS must match the block size");
+
+// The blocks are far too big for the stack the Scope lives on. They are aligned to their size so each
+// channel can write them as a ring. The last one is the scratch block.
+static uint16_t streamSamples[STREAM_BLOCKS + 1][STREAM_BLOCK_SAMPLES] __attribute__((aligned(STREAM_BLOCK_SAMPLES * 2)));
+static StreamBlock streamBlocks[STREAM_BLOCKS + 1];
+
+Streamer *Streamer::dmaStreamer = NULL;
+
+Streamer::Streamer()
+{
+    for(int index = 0; index <= STREAM_BLOCKS; index++) streamBlocks[index].samples = streamSamples[index];
+    scratch = &streamBlocks[STREAM_BLOCKS];
+    for(int index = 0; index < STREAM_BLOCKS; index++) freeQueue.push(&streamBlocks[index]);
+}
+
+void Streamer::staticDmaHandler()
+{
+    if(dmaStreamer) dmaStreamer->dmaCallback();
+}
+
+// Point a channel at the next free block, or the scratch block if core0 still has them all.
+// The channel starts when the other one chains to it.
+void Streamer::arm(int index)
+{
+    StreamBlock *block;
+    if(!freeQueue.pop(block)) block = scratch;
+    channelBlocks[index] = block;
+    dma_channel_set_write_addr(dmaChannels[index], block->samples, false);
+}
+
+bool Streamer::start(uint32_t intervalNs, Capture *captureMeter)
+{
+    if(running.load(std::memory_order_relaxed)) return true;
+    for(int index = 0; index < 2; index++)
+    {
+        if(dmaChannels[index] < 0) dmaChannels[index] = dma_claim_unused_channel(false);
+        if(dmaChannels[index] < 0) return false;
+    }
+    meter = captureMeter;
+    dmaStreamer = this;
+    irq_set_exclusive_handler(DMA_IRQ_1, staticDmaHandler);
+    irq_set_enabled(DMA_IRQ_1, true);
+
+    if(intervalNs < DMA_MIN_SAMPLE_INTERVAL_NS) intervalNs = DMA_MIN_SAMPLE_INTERVAL_NS;
+    if(intervalNs > DMA_MAX_SAMPLE_INTERVAL_NS) intervalNs = DMA_MAX_SAMPLE_INTERVAL_NS;
+    uint32_t adcClocks = (uint64_t)intervalNs * (ADC_CLOCK_HZ / 1000000) / 1000;
+    sampleIntervalNs = adcClocks * 1000 / (ADC_CLOCK_HZ / 1000000);
+
+    // Each channel fills one block from the FIFO, then starts the other
+    for(int index = 0; index < 2; index++)
+    {
+        dma_channel_config cfg = dma_channel_get_default_config(dmaChannels[index]);
+        channel_config_set_transfer_data_size(&cfg, DMA_SIZE_16);
+        channel_config_set_read_increment(&cfg, false);
+        channel_config_set_write_increment(&cfg, true);
+        channel_config_set_ring(&cfg, true, STREAM_RING_BITS);
+        channel_config_set_dreq(&cfg, DREQ_ADC);
+        channel_config_set_chain_to(&cfg, dmaChannels[index ^ 1]);
+        dma_channel_configure(dmaChannels[index], &cfg, NULL, &adc_hw->fifo, STREAM_BLOCK_SAMPLES, false);
+        arm(index);
+        dma_channel_acknowledge_irq1(dmaChannels[index]);
+        dma_channel_set_irq1_enabled(dmaChannels[index], true);
+    }
+    nextChannel = 0;
+    nextSequence = 0;
+    lostBlocks = 0;
+
+    adc_fifo_setup(true, true, 1, false, false);
+    adc_set_clkdiv(adcClocks - 1);     // A conversion starts every (1 + div) ADC clocks
+    adc_fifo_drain();
+    dma_channel_start(dmaChannels[0]);
+    startTime = time_us_64();
+    running.store(true, std::memory_order_release);
+    adc_run(true);
+    return true;
+}
+
+void Streamer::stop()
+{
+    if(!running.load(std::memory_order_relaxed)) return;
+    adc_run(false);
+    for(int index = 0; index < 2; index++)
+    {
+        // Break the chain first - aborting a channel can otherwise start the one it chains to
+        dma_channel_set_irq1_enabled(dmaChannels[index], false);
+        dma_channel_config cfg = dma_channel_get_default_config(dmaChannels[index]);
+        dma_channel_set_config(dmaChannels[index], &cfg, false);
+    }
+    for(int index = 0; index < 2; index++)
+    {
+        dma_channel_abort(dmaChannels[index]);
+        dma_channel_acknowledge_irq1(dmaChannels[index]);
+        // Partly filled blocks go back to core0 empty so it can return them
+        StreamBlock *block = channelBlocks[index];
+        channelBlocks[index] = NULL;
+        if(block == scratch) continue;
+        block->sampleCount = 0;
+        filledQueue.push(block);
+    }
+    adc_fifo_setup(false, false, 0, false, false);
+    adc_fifo_drain();
+    adc_set_clkdiv(0);
+    running.store(false, std::memory_order_release);
+}
+
+void Streamer::dmaCallback()
+{
+    PROFILE_REGION(streamIsr);
+    // The channels complete in turn. The other channel is already filling its block.
+    while(dma_channel_get_irq1_status(dmaChannels[nextChannel]))
+    {
+        int index = nextChannel;
+        nextChannel ^= 1;
+        dma_channel_acknowledge_irq1(dmaChannels[index]);
+        StreamBlock *block = channelBlocks[index];
+        uint64_t timestamp = startTime + (uint64_t)nextSequence * STREAM_BLOCK_SAMPLES * sampleIntervalNs / 1000;
+        meter->meterSamples(block->samples, STREAM_BLOCK_SAMPLES, timestamp, sampleIntervalNs);
+        if(block == scratch)
+        {
+            lostBlocks++;
+        }
+        else
+        {
+            block->sequence = nextSequence;
+            block->timestampUs = timestamp;
+            block->sampleCount = STREAM_BLOCK_SAMPLES;
+            block->lostBefore = lostBlocks;
+            lostBlocks = 0;
+            filledQueue.push(block);    // Holds every block there is, so this never fails
+        }
+        nextSequence++;
+        arm(index);
+    }
+}
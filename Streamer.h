@@ -0,0 +1,84 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __STREAMER_H__
+#define __STREAMER_H__
+
+// Continuous ADC streaming. Two DMA channels chained to each other take turns filling blocks from the
+// ADC FIFO, so the ADC never waits between blocks. As each block completes its channel is pointed at
+// the next free block. Filled blocks go to core0 to be sent over USB and come back when sent.
+// If core0 falls behind and no block is free, the channel fills a scratch block instead and that
+// block is lost - the sequence numbers show the gap.
+// The interrupt has one block time (2ms at full rate) to point the finished channel at its next block.
+// Each channel writes as a ring the size of a block, so a late interrupt overwrites that block rather
+// than running on into whatever follows it.
+
+#include <atomic>
+#include "Capture.h"
+#include "SpscQueue.h"
+#include "StreamFrame.h"
+
+#define STREAM_BLOCKS       8       // Blocks shared between the DMA and the USB sender
+#define STREAM_RING_BITS    11      // log2 of the block size in bytes
+
+typedef struct StreamBlockStruct
+{
+    uint32_t sequence = 0;      // Block number since the stream started
+    uint64_t timestampUs = 0;   // Time of the first sample
+    uint16_t sampleCount = 0;   // Valid samples. Zero if the stream stopped before the block was filled.
+    uint16_t lostBefore = 0;    // Blocks dropped on the device since the previous block
+    uint16_t *samples = NULL;   // STREAM_BLOCK_SAMPLES raw 12 bit ADC values
+} StreamBlock;
+
+class Streamer
+{
+    public:
+        Streamer();     // Construct on core0 - it hands out the free blocks
+
+        // Core1 side. The capture's meter is kept up to date from the streamed samples.
+        bool start(uint32_t sampleIntervalNs, Capture *meter);
+        void stop();
+        bool isRunning() { return running.load(std::memory_order_acquire); }
+        uint32_t getSampleIntervalNs() { return sampleIntervalNs; }
+
+        // Core0 side. Blocks must be released once they have been sent.
+        bool getBlock(StreamBlock *&block) { return filledQueue.pop(block); }
+        void releaseBlock(StreamBlock *block) { freeQueue.push(block); }
+
+    private:
+        static Streamer *dmaStreamer;   // Streamer that owns the DMA interrupt
+        static void staticDmaHandler();
+        void dmaCallback();
+        void arm(int index);
+
+        StreamBlock *scratch;               // Filled when core0 has no block free
+        SpscQueue<StreamBlock *, STREAM_BLOCKS> freeQueue;      // Core0 -> core1: blocks to fill
+        SpscQueue<StreamBlock *, STREAM_BLOCKS> filledQueue;    // Core1 -> core0: blocks to send
+
+        int dmaChannels[2] = { -1, -1 };
+        StreamBlock *channelBlocks[2] = { NULL, NULL };     // Block each channel is filling
+        int nextChannel = 0;                // Channel whose block completes next
+        std::atomic<bool> running{false};
+        Capture *meter = NULL;
+        uint32_t sampleIntervalNs = 0;
+        uint64_t startTime = 0;             // Time of the first sample
+        uint32_t nextSequence = 0;          // Sequence of the next block to complete
+        uint16_t lostBlocks = 0;            // Scratch blocks filled since the last block was handed over
+};
+
+#endif
@@ -0,0 +1,75 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __TIMEBASE_H__
+#define __TIMEBASE_H__
+
+// Automatic timebase. The screen width (NUM_SAMPLES samples) is sized to show about TIMEBASE_TARGET_PERIODS
+// periods of the measured frequency, rounded up to a step of a 10 per decade series so the labels stay tidy.
+// Once chosen, the timebase is kept while the screen shows between TIMEBASE_MIN_PERIODS and
+// TIMEBASE_MAX_PERIODS periods, so a reading that wobbles between two steps doesn't flip the screen.
+// Every step is a whole number of ADC clocks at 2us and above, and a whole number of timer ticks from 1ms.
+
+#include <stdint.h>
+#include "CaptureBuffer.h"
+
+#define TIMEBASE_TARGET_PERIODS     4
+#define TIMEBASE_MIN_PERIODS        3
+#define TIMEBASE_MAX_PERIODS        6
+#define TIMEBASE_MIN_INTERVAL_NS    2000            // The ADC's fastest conversion
+#define TIMEBASE_MAX_SPAN_NS        1000000000ULL   // Slowest screen - below TARGET_PERIODS Hz fewer periods are shown
+
+class Timebase
+{
+    public:
+        // Sample interval for a signal of frequencyHz. Zero (no signal) gives the slowest screen.
+        uint32_t sampleIntervalFor(uint32_t frequencyHz)
+        {
+            if(currentIntervalNs != 0 && frequencyHz != 0)
+            {
+                // Periods shown, in thousandths
+                uint64_t shown = (uint64_t)frequencyHz * currentIntervalNs * NUM_SAMPLES / 1000000;
+                if(shown >= TIMEBASE_MIN_PERIODS * 1000 && shown <= TIMEBASE_MAX_PERIODS * 1000) return currentIntervalNs;
+            }
+            uint64_t desiredSpan = (frequencyHz == 0)? TIMEBASE_MAX_SPAN_NS: TIMEBASE_TARGET_PERIODS * 1000000000ULL / frequencyHz;
+            uint64_t span = stepAtLeast(desiredSpan);
+            if(span < (uint64_t)TIMEBASE_MIN_INTERVAL_NS * NUM_SAMPLES) span = (uint64_t)TIMEBASE_MIN_INTERVAL_NS * NUM_SAMPLES;
+            if(span > TIMEBASE_MAX_SPAN_NS) span = TIMEBASE_MAX_SPAN_NS;
+            currentIntervalNs = span / NUM_SAMPLES;
+            return currentIntervalNs;
+        }
+
+    private:
+        // Smallest step of the series that is at least spanNs
+        static uint64_t stepAtLeast(uint64_t spanNs)
+        {
+            static const uint8_t steps[] = { 10, 12, 15, 20, 25, 30, 40, 50, 60, 80 };
+            for(uint64_t decade = 10000; decade <= TIMEBASE_MAX_SPAN_NS; decade *= 10)
+            {
+                for(uint8_t step : steps)
+                {
+                    if(step * decade >= spanNs) return step * decade;
+                }
+            }
+            return TIMEBASE_MAX_SPAN_NS;
+        }
+
+        uint32_t currentIntervalNs = 0;
+};
+
+#endif
@@ -0,0 +1,101 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __TRIGGER_H__
+#define __TRIGGER_H__
+
+// Capture trigger. It watches the samples as they are stored, independently of the frequency counter.
+// The trigger arms once the signal is hysteresis counts on the far side of the level, and fires on the
+// first sample that reaches the level on the chosen slope. Where the level was crossed between that
+// sample and the one before is interpolated to 1/256th of a sample, so the display can put the crossing
+// at the same place on every frame instead of jumping by a whole sample.
+// Tested along with the capture buffer by host/CaptureBufferTest.cpp.
+
+#include <stdint.h>
+
+#define TRIGGER_LEVEL_AUTO      -1  // Follow the signal - just above its recent low
+#define TRIGGER_AUTO_OFFSET     30  // Auto level is this far above the recent low (about 0.15V)
+#define TRIGGER_FRACTION_ONE    256 // Sub-sample positions are in 256ths
+#define TRIGGER_MIN_HYSTERESIS  1   // With none a sample on the level would arm the trigger, and the next one on it fire
+
+enum TriggerSlope : uint8_t
+{
+    triggerRising = 0,
+    triggerFalling
+};
+
+typedef struct TriggerSettingsStruct
+{
+    int16_t level = TRIGGER_LEVEL_AUTO;     // 10 bit ADC level, or TRIGGER_LEVEL_AUTO
+    TriggerSlope slope = triggerRising;
+    uint16_t hysteresis = TRIGGER_AUTO_OFFSET;  // Counts beyond the level the signal must go before the trigger arms (at least TRIGGER_MIN_HYSTERESIS)
+    uint32_t holdoffUs = 0;                 // A frame won't trigger until this long after the previous frame's trigger
+} TriggerSettings;
+
+class TriggerDetector
+{
+    public:
+        // Start watching for a trigger. autoLevel is used when the settings ask for TRIGGER_LEVEL_AUTO.
+        inline void begin(const TriggerSettings &settings, uint16_t autoLevel)
+        {
+            level = (settings.level == TRIGGER_LEVEL_AUTO)? autoLevel: settings.level;
+            rising = settings.slope == triggerRising;
+            uint16_t hysteresis = (settings.hysteresis < TRIGGER_MIN_HYSTERESIS)? TRIGGER_MIN_HYSTERESIS: settings.hysteresis;
+            armLevel = rising? level - hysteresis: level + hysteresis;
+            armed = false;
+            fraction = 0;
+        }
+
+        // Returns true if this sample fires the trigger. Arms again by itself.
+        inline bool sample(uint16_t value)
+        {
+            int32_t current = value;
+            int32_t last = previous;
+            previous = value;
+            if(!armed)
+            {
+                armed = rising? current <= armLevel: current >= armLevel;
+                return false;
+            }
+            if(rising? current < level: current > level) return false;
+            armed = false;
+            // The trigger armed at least a count short of the level and hasn't reached it since, so the previous
+            // sample is on the other side of the level. Checked anyway - a division by zero would fault core1.
+            if(current == last)
+            {
+                fraction = 0;
+                return true;
+            }
+            int32_t position = (level - last) * TRIGGER_FRACTION_ONE / (current - last);
+            fraction = (position < 0)? 0: (position >= TRIGGER_FRACTION_ONE)? TRIGGER_FRACTION_ONE - 1: position;
+            return true;
+        }
+
+        // Where the level was crossed on the way to the sample that fired, in 256ths of a sample after the one before it
+        inline uint8_t getFraction() { return fraction; }
+
+    private:
+        int32_t level = 0;
+        int32_t armLevel = 0;
+        bool rising = true;
+        bool armed = false;
+        uint16_t previous = 0;
+        uint8_t fraction = 0;
+};
+
+#endif
@@ -0,0 +1,36 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Voltmeter.h"
+#include "Profiler.h"
+
+// Too big for the stack core1 runs on
+static uint16_t voltmeterSamples[VOLTMETER_SAMPLES];
+
+bool Voltmeter::start()
+{
+    return burst.start(voltmeterSamples, VOLTMETER_SAMPLES, DMA_MIN_SAMPLE_INTERVAL_NS);    // As fast as the ADC goes
+}
+
+bool Voltmeter::finish(PrecisionReading &reading, Capture *meter)
+{
+    if(!burst.finish(meter)) return false;
+    PROFILE_REGION(voltmeter);
+    reading = oversample(voltmeterSamples, VOLTMETER_SAMPLES);
+    return true;
+}
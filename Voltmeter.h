@@ -0,0 +1,45 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __VOLTMETER_H__
+#define __VOLTMETER_H__
+
+// Precision voltmeter. A burst of full rate 12 bit readings (see AdcBurst.h) is oversampled to 14 bits
+// (see Oversampler.h).
+
+#include "AdcBurst.h"
+#include "Oversampler.h"
+
+#define VOLTMETER_SAMPLES   4096    // Readings in each burst: 8ms at 500 kS/s
+
+class Voltmeter
+{
+    public:
+        // Start a burst. The ADC must be lent by the capture first.
+        bool start();
+        bool isRunning() { return burst.isRunning(); }
+
+        // Returns true once the burst has finished, with its reading. The readings are also fed through
+        // the capture's meter so the frequency counter doesn't miss them.
+        bool finish(PrecisionReading &reading, Capture *meter);
+
+    private:
+        AdcBurst burst;
+};
+
+#endif
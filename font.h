@@ -7,6 +7,9 @@
  * <first ascii char>, <last ascii char>,
  * <data>
  */
+#ifdef __cplusplus
+constexpr   // lets C++ expand the font at compile time (see GlyphCache.h)
+#endif
 const uint8_t font_8x5[] =
 {
 			8, 5, 1, 32, 126,
@@ -0,0 +1,270 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Checks the capture buffer and trigger logic (CaptureBuffer.h, Trigger.h) against synthetic sample streams,
+// fed one sample at a time the way the timer engine feeds them, or as a block the way the DMA engine does.
+// Exits with 1 if any check fails.
+
+#include <stdint.h>
+#include <initializer_list>
+#include "CaptureBuffer.h"
+#include "HostCheck.h"
+
+#define STREAM_LENGTH   400
+#define LOW_LEVEL       100     // The stream sits around here before its edge
+#define HIGH_LEVEL      900     // and here after it
+#define TRIGGER_LEVEL   500
+
+// A flat stream with a little ripple that steps up at edge. Every value is different so a misplaced
+// sample can't match by accident.
+static void makeStep(uint16_t *stream, uint16_t edge)
+{
+    for(uint16_t index = 0; index < STREAM_LENGTH; index++)
+    {
+        stream[index] = ((index < edge)? LOW_LEVEL: HIGH_LEVEL) + index % 97;
+    }
+}
+
+static void startCapture(CapturedData &cap, TriggerDetector &trigger, uint8_t percent, bool circular)
+{
+    TriggerSettings settings;
+    settings.level = TRIGGER_LEVEL;
+    cap.reset();
+    cap.preTriggerPercent = percent;
+    cap.circular = circular;
+    cap.acquireMode = acquireSample;
+    trigger.begin(settings, 0);
+}
+
+// Feed the stream until the capture completes. Returns the samples it took, 0 if it never completed.
+static uint16_t feed(CapturedData &cap, TriggerDetector &trigger, const uint16_t *stream)
+{
+    for(uint16_t index = 0; index < STREAM_LENGTH; index++)
+    {
+        bool crossing = trigger.sample(stream[index]);
+        if(cap.addSample(stream[index], stream[index], crossing, trigger.getFraction())) return index + 1;
+    }
+    return 0;
+}
+
+// The displayed samples must be the stream from first onwards
+static void checkDisplayed(CapturedData &cap, const uint16_t *stream, uint16_t first, const char *what)
+{
+    for(uint16_t x = 0; x < NUM_SAMPLES; x++)
+    {
+        if(cap.sampleAt(x) != stream[first + x])
+        {
+            CHECK(false, "%s: displayed sample %u is %u, expected stream[%u] = %u", what, x, cap.sampleAt(x), first + x, stream[first + x]);
+            return;
+        }
+    }
+}
+
+static void testPreTriggerSamples()
+{
+    CapturedData cap;
+    const struct { uint8_t percent; uint16_t samples; } cases[] = { { 0, 0 }, { 10, 9 }, { 50, 49 }, { 100, 99 }, { 101, 99 }, { 255, 99 } };
+    for(auto &expected : cases)
+    {
+        cap.preTriggerPercent = expected.percent;
+        CHECK(cap.preTriggerSamples() == expected.samples, "preTriggerSamples at %u%% is %u, expected %u",
+            expected.percent, cap.preTriggerSamples(), expected.samples);
+    }
+}
+
+// Linear captures (DMA layout filled a sample at a time): the trigger lands preTrigger samples into the display
+static void testLinear()
+{
+    static uint16_t stream[STREAM_LENGTH];
+    CapturedData cap;
+    TriggerDetector trigger;
+    for(uint8_t percent : { 0, 10, 50, 100 })
+    {
+        uint16_t preTrigger = (uint16_t)percent * (NUM_SAMPLES - 1) / 100;
+        for(uint16_t edge : { 1, 20, 60, 99, 100 })
+        {
+            if(edge < preTrigger) continue;     // The trigger isn't taken until the history is there
+            makeStep(stream, edge);
+            startCapture(cap, trigger, percent, false);
+            uint16_t taken = feed(cap, trigger, stream);
+            CHECK(taken != 0, "linear %u%% edge %u: never completed", percent, edge);
+            if(edge < NUM_SAMPLES + preTrigger)
+            {
+                CHECK(cap.triggerLocation == edge, "linear %u%% edge %u: trigger at %d", percent, edge, cap.triggerLocation);
+                CHECK(cap.startLocation == edge - preTrigger, "linear %u%% edge %u: display starts at %u", percent, edge, cap.startLocation);
+                checkDisplayed(cap, stream, edge - preTrigger, "linear");
+            }
+            else
+            {
+                // Gave up before the edge: the first NUM_SAMPLES are shown untriggered
+                CHECK(cap.triggerLocation < 0 && taken == NUM_SAMPLES + preTrigger, "linear %u%% edge %u: trigger at %d after %u samples",
+                    percent, edge, cap.triggerLocation, taken);
+                checkDisplayed(cap, stream, 0, "linear untriggered");
+            }
+        }
+    }
+}
+
+// Circular captures keep sampling into the ring until triggered. The ring arithmetic is checked from
+// every starting position, not only from 0 where a capture normally starts, so the display wraps the
+// end of the buffer at every possible point.
+static void testCircular()
+{
+    static uint16_t stream[STREAM_LENGTH];
+    CapturedData cap;
+    TriggerDetector trigger;
+    for(uint8_t percent : { 0, 10, 50, 100 })
+    {
+        uint16_t preTrigger = (uint16_t)percent * (NUM_SAMPLES - 1) / 100;
+        for(uint16_t edge : { 1, 5, 60, 120, 180 })
+        {
+            for(uint16_t origin = 0; origin < CAPTURE_BUFFER_SIZE; origin++)
+            {
+                makeStep(stream, edge);
+                startCapture(cap, trigger, percent, true);
+                cap.currentSample = origin;
+                uint16_t taken = feed(cap, trigger, stream);
+                if(edge + 1 > preTrigger && edge < NUM_SAMPLES + preTrigger - 1)
+                {
+                    // Triggered: the edge is preTrigger samples in, and the rest of the display follows it
+                    CHECK(taken == edge + NUM_SAMPLES - preTrigger, "circular %u%% edge %u origin %u: took %u samples",
+                        percent, edge, origin, taken);
+                    CHECK(cap.triggerLocation == (origin + edge) % CAPTURE_BUFFER_SIZE, "circular %u%% edge %u origin %u: trigger at %d",
+                        percent, edge, origin, cap.triggerLocation);
+                    checkDisplayed(cap, stream, edge - preTrigger, "circular triggered");
+                }
+                else
+                {
+                    // No trigger in time: the last NUM_SAMPLES are shown as they are
+                    CHECK(taken == NUM_SAMPLES + preTrigger, "circular %u%% edge %u origin %u: untriggered after %u samples",
+                        percent, edge, origin, taken);
+                    CHECK(cap.triggerLocation < 0, "circular %u%% edge %u origin %u: triggered", percent, edge, origin);
+                    checkDisplayed(cap, stream, taken - NUM_SAMPLES, "circular untriggered");
+                }
+            }
+        }
+    }
+}
+
+// Block captures only take a crossing with room for the whole display around it
+static void testBlockCrossing()
+{
+    CapturedData cap;
+    for(uint8_t percent : { 0, 10, 100 })
+    {
+        uint16_t preTrigger = (uint16_t)percent * (NUM_SAMPLES - 1) / 100;
+        for(uint16_t x = 0; x < CAPTURE_BUFFER_SIZE; x++)
+        {
+            cap.reset();
+            cap.preTriggerPercent = percent;
+            cap.addBlockCrossing(x, 7);
+            bool fits = x >= preTrigger && x + NUM_SAMPLES - preTrigger <= CAPTURE_BUFFER_SIZE;
+            CHECK((cap.triggerLocation >= 0) == fits, "block %u%% crossing at %u: accepted %d", percent, x, cap.triggerLocation >= 0);
+            if(fits)
+            {
+                CHECK(cap.startLocation == x - preTrigger && cap.triggerFraction == 7, "block %u%% crossing at %u: starts at %u",
+                    percent, x, cap.startLocation);
+            }
+        }
+    }
+    // Only the first is taken
+    cap.reset();
+    cap.preTriggerPercent = 10;
+    cap.addBlockCrossing(50, 1);
+    cap.addBlockCrossing(60, 2);
+    CHECK(cap.triggerLocation == 50 && cap.triggerFraction == 1, "block: a second crossing moved the trigger");
+}
+
+// The trigger fires once per edge on the chosen slope, and places the crossing between samples
+static void testTriggerDetector()
+{
+    TriggerDetector trigger;
+    TriggerSettings settings;
+    settings.level = 500;
+    settings.hysteresis = 30;
+    trigger.begin(settings, 0);
+    CHECK(!trigger.sample(400), "rising: fired while arming");
+    CHECK(trigger.sample(600), "rising: missed the crossing");
+    CHECK(trigger.getFraction() == 128, "rising: 400 to 600 through 500 is halfway, got %u/256", trigger.getFraction());
+    CHECK(!trigger.sample(700), "rising: fired again without rearming");
+    CHECK(!trigger.sample(480), "rising: rearmed inside the hysteresis");
+    CHECK(!trigger.sample(520), "rising: fired without rearming");
+    CHECK(!trigger.sample(470), "rising: fired while rearming");
+    CHECK(trigger.sample(570), "rising: missed the crossing after rearming");
+    CHECK(trigger.getFraction() == 76, "rising: 470 to 570 through 500 is 30/100, got %u/256", trigger.getFraction());
+
+    settings.slope = triggerFalling;
+    trigger.begin(settings, 0);
+    CHECK(!trigger.sample(600), "falling: fired while arming");
+    CHECK(!trigger.sample(550), "falling: fired above the level");
+    CHECK(trigger.sample(450), "falling: missed the crossing");
+    CHECK(trigger.getFraction() == 128, "falling: 550 to 450 through 500 is halfway, got %u/256", trigger.getFraction());
+
+    // No hysteresis is treated as the least there can be. Samples sitting on the level must not arm it,
+    // or the next one on the level would fire with no change to interpolate over.
+    settings = TriggerSettings();
+    settings.level = 500;
+    settings.hysteresis = 0;
+    trigger.begin(settings, 0);
+    for(uint16_t value : {600, 500, 500, 600}) CHECK(!trigger.sample(value), "no hysteresis: %u fired on the level", value);
+    CHECK(!trigger.sample(499), "no hysteresis: fired while arming");
+    CHECK(trigger.sample(500), "no hysteresis: missed the level");
+    CHECK(trigger.getFraction() == TRIGGER_FRACTION_ONE - 1, "no hysteresis: 499 to 500 reaches the level at the sample, got %u/256", trigger.getFraction());
+    settings.slope = triggerFalling;
+    trigger.begin(settings, 0);
+    for(uint16_t value : {400, 500, 500, 400}) CHECK(!trigger.sample(value), "no hysteresis: %u fired on the level falling", value);
+
+    // The auto level is used when the settings don't give one
+    settings = TriggerSettings();
+    trigger.begin(settings, 300);
+    trigger.sample(200);
+    CHECK(!trigger.sample(299), "auto: fired below the level");
+    CHECK(trigger.sample(301), "auto: missed the level");
+}
+
+// The frequency counter's detector counts one crossing per cycle of a signal well clear of the baseline
+static void testCrossingDetector()
+{
+    CrossingDetector detector;
+    uint32_t crossings = 0;
+    for(uint32_t index = 0; index < 10000; index++)
+    {
+        // 25 cycles of a triangle from 0 to 600 counts
+        uint32_t phase = index % 400;
+        uint16_t value = (phase < 200)? phase * 3: (400 - phase) * 3;
+        if(detector.sample(value)) crossings++;
+    }
+    CHECK(crossings == 25, "crossing detector counted %u cycles of 25", crossings);
+
+    // Ripple smaller than the threshold never counts
+    detector = CrossingDetector();
+    crossings = 0;
+    for(uint32_t index = 0; index < 1000; index++) if(detector.sample(20 + index % 25)) crossings++;
+    CHECK(crossings == 0, "crossing detector counted %u cycles of ripple", crossings);
+}
+
+int main()
+{
+    testPreTriggerSamples();
+    testLinear();
+    testCircular();
+    testBlockCrossing();
+    testTriggerDetector();
+    testCrossingDetector();
+    return checkResult("CaptureBuffer");
+}
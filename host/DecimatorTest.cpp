@@ -0,0 +1,120 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Checks the Decimator in CaptureBuffer.h, which reduces the readings between stored samples to one value
+// (and a low in peak detect mode). Known sequences go through add and take in each acquire mode.
+// Exits with 1 if any check fails.
+
+#include <stdint.h>
+#include <initializer_list>
+#include "CaptureBuffer.h"
+#include "HostCheck.h"
+
+static const char *modeNames[] = { "sample", "peak", "average" };
+
+// Adds values, takes with latest as the reading just added, and checks the value and low
+static void checkTake(AcquireMode mode, std::initializer_list<uint16_t> values, uint16_t latest,
+    uint16_t expectedValue, uint16_t expectedLow)
+{
+    Decimator decimator;
+    for(uint16_t value : values) decimator.add(value);
+    uint16_t low = 0;
+    uint16_t value = decimator.take(mode, latest, low);
+    CHECK(value == expectedValue && low == expectedLow, "%s of %zu readings: %u low %u, expected %u low %u",
+        modeNames[mode], values.size(), value, low, expectedValue, expectedLow);
+}
+
+static void testSample()
+{
+    // Sample mode stores the latest reading whatever came before it
+    checkTake(acquireSample, {100, 900, 5, 321}, 321, 321, 321);
+    checkTake(acquireSample, {7}, 7, 7, 7);
+}
+
+static void testPeak()
+{
+    checkTake(acquirePeak, {500, 1023, 3, 600}, 600, 1023, 3);
+    checkTake(acquirePeak, {10, 20, 30, 40}, 40, 40, 10);       // Rising - the latest is the high
+    checkTake(acquirePeak, {40, 30, 20, 10}, 10, 40, 10);       // Falling - the latest is the low
+    checkTake(acquirePeak, {512}, 512, 512, 512);               // One reading is both
+    checkTake(acquirePeak, {0, 4095, 0, 0}, 0, 4095, 0);        // A one reading glitch either way is kept
+    checkTake(acquirePeak, {4095, 0, 4095, 4095}, 4095, 4095, 0);
+}
+
+static void testAverage()
+{
+    checkTake(acquireAverage, {100, 200, 300, 400}, 400, 250, 250);
+    // (sum + count/2) / count rounds to the nearest, half up
+    checkTake(acquireAverage, {0, 0, 0, 1}, 1, 0, 0);           // 0.25
+    checkTake(acquireAverage, {0, 0, 1, 1}, 1, 1, 1);           // 0.5 rounds up
+    checkTake(acquireAverage, {0, 1, 1, 1}, 1, 1, 1);           // 0.75
+    checkTake(acquireAverage, {10, 11, 11}, 11, 11, 11);        // 10.67
+    checkTake(acquireAverage, {10, 10, 11}, 11, 10, 10);        // 10.33
+    checkTake(acquireAverage, {1, 2}, 2, 2, 2);                 // 1.5 with an even count
+    checkTake(acquireAverage, {1, 2, 2, 2, 2}, 2, 2, 2);        // 1.8 with an odd count
+    // As many full scale readings as count can hold don't overflow the sum
+    Decimator decimator;
+    for(uint16_t reading = 0; reading < UINT16_MAX; reading++) decimator.add(4095);
+    uint16_t low = 0;
+    uint16_t value = decimator.take(acquireAverage, 4095, low);
+    CHECK(value == 4095 && low == 4095, "average of 65535 full scale readings: %u", value);
+}
+
+// With nothing added every mode stores the latest reading
+static void testEmptyInterval()
+{
+    for(AcquireMode mode : {acquireSample, acquirePeak, acquireAverage})
+    {
+        checkTake(mode, {}, 77, 77, 77);
+    }
+}
+
+// take starts the next interval, so nothing from one interval leaks into the next
+static void testReset()
+{
+    Decimator decimator;
+    uint16_t low = 0;
+    for(uint16_t value : {900, 1000, 50}) decimator.add(value);
+    decimator.take(acquirePeak, 50, low);
+    for(uint16_t value : {400, 410, 405}) decimator.add(value);
+    uint16_t value = decimator.take(acquirePeak, 405, low);
+    CHECK(value == 410 && low == 400, "peak after an interval: %u low %u, expected 410 low 400", value, low);
+
+    for(uint16_t value : {1000, 1000}) decimator.add(value);
+    decimator.take(acquireAverage, 1000, low);
+    for(uint16_t value : {2, 4}) decimator.add(value);
+    value = decimator.take(acquireAverage, 4, low);
+    CHECK(value == 3, "average after an interval: %u, expected 3", value);
+
+    // A take with nothing added still leaves it empty
+    decimator.take(acquirePeak, 9, low);
+    value = decimator.take(acquirePeak, 123, low);
+    CHECK(value == 123 && low == 123, "empty interval after an empty take: %u low %u", value, low);
+    CHECK(decimator.count == 0 && decimator.sum == 0 && decimator.high == 0 && decimator.low == UINT16_MAX,
+        "take didn't reset the decimator");
+}
+
+int main()
+{
+    testSample();
+    testPeak();
+    testAverage();
+    testEmptyInterval();
+    testReset();
+    return checkResult("Decimator");
+}
@@ -0,0 +1,182 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Checks the spectrum analyzer (see Spectrum.h) against a double precision FFT of the same readings, and
+// times it. For each size from 256 to 1024 points a set of test signals goes through both. The error is
+// reported as a signal to noise ratio over the displayed bins, and as the worst error in any one bin
+// against a full scale sine, which must stay below the bottom of the display. The peak frequency readout
+// is checked against the frequency of the test tone. Exits with 1 if any check fails.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <complex>
+#include <chrono>
+#include "Spectrum.h"
+
+#define MAX_BIN_ERROR_DB    -66.0   // Worst error in a bin against a full scale sine: a pixel below the 64 dB the display shows
+#define MAX_PEAK_ERROR_BINS 0.1     // Peak readout must be this close to the test tone
+#define BENCH_SECONDS       0.5     // Time spent timing each size
+
+typedef std::complex<double> Complex;
+
+// Reference: textbook iterative radix-2 FFT in double precision
+static void referenceFft(Complex *data, uint16_t points)
+{
+    for(uint16_t index = 1, reversed = 0; index < points; index++)
+    {
+        uint16_t bit = points >> 1;
+        for(; reversed & bit; bit >>= 1) reversed ^= bit;
+        reversed |= bit;
+        if(index < reversed) std::swap(data[index], data[reversed]);
+    }
+    for(uint16_t size = 2; size <= points; size <<= 1)
+    {
+        for(uint16_t k = 0; k < size / 2; k++)
+        {
+            Complex twiddle = std::polar(1.0, -2 * M_PI * k / size);
+            for(uint16_t top = k; top < points; top += size)
+            {
+                Complex product = twiddle * data[top + size / 2];
+                data[top + size / 2] = data[top] - product;
+                data[top] += product;
+            }
+        }
+    }
+}
+
+// 12 bit readings of a test signal. cycles is the number of periods across the block.
+static void makeSignal(const char *name, uint16_t *samples, uint16_t points, double cycles, uint32_t seed)
+{
+    srand(seed);
+    for(uint16_t index = 0; index < points; index++)
+    {
+        double phase = 2 * M_PI * cycles * index / points;
+        double value;
+        if(strcmp(name, "sine") == 0) value = 2047.5 + 2047 * sin(phase);
+        else if(strcmp(name, "small sine") == 0) value = 2047.5 + 20 * sin(phase);
+        else if(strcmp(name, "two tone") == 0) value = 2047.5 + 1800 * sin(phase) + 18 * sin(phase * 3.7);
+        else if(strcmp(name, "square") == 0) value = (sin(phase) >= 0)? 4000: 100;
+        else value = rand() % 4096;
+        samples[index] = (value < 0)? 0: (value > 4095)? 4095: (uint16_t)(value + 0.5);
+    }
+}
+
+int main()
+{
+    static const char *signals[] = { "sine", "small sine", "two tone", "square", "noise" };
+    static uint16_t samples[SPECTRUM_MAX_POINTS];
+    static int16_t re[SPECTRUM_MAX_POINTS];     // For timing the transform on its own
+    static int16_t im[SPECTRUM_MAX_POINTS];
+    static Complex reference[SPECTRUM_MAX_POINTS];
+    static Spectrum spectrum;
+    bool passed = true;
+
+    printf("%-6s %-12s %10s %14s %12s\n", "points", "signal", "snr dB", "bin error dB", "peak error");
+    for(uint8_t bits = SPECTRUM_MIN_BITS; bits <= SPECTRUM_MAX_BITS; bits++)
+    {
+        uint16_t points = 1 << bits;
+        for(const char *signal : signals)
+        {
+            double cycles = points / 16 + 0.37;     // Between bins, where the error is largest
+            makeSignal(signal, samples, points, cycles, bits);
+
+            // Reference: the same readings, mean removed and windowed in double precision, on the scale
+            // Spectrum uses - readings shifted up by SPECTRUM_INPUT_SHIFT and a 1/N transform
+            spectrum.compute(samples, points, 1000);
+            double mean = 0;
+            for(uint16_t index = 0; index < points; index++) mean += samples[index];
+            mean /= points;
+            for(uint16_t index = 0; index < points; index++)
+            {
+                double window = 0.5 - 0.5 * cos(2 * M_PI * index / points);
+                reference[index] = Complex((samples[index] - mean) * (1 << SPECTRUM_INPUT_SHIFT) * window / points, 0);
+            }
+            referenceFft(reference, points);
+
+            // Only the bins the display uses
+            double scale = ldexp(1.0, spectrum.getExponent());
+            double signalPower = 0;
+            double errorPower = 0;
+            double worstError = 0;
+            for(uint16_t bin = SPECTRUM_SKIP_BINS; bin < points / 2; bin++)
+            {
+                Complex actual(spectrum.getReal()[bin] * scale, spectrum.getImaginary()[bin] * scale);
+                double error = std::norm(actual - reference[bin]);
+                signalPower += std::norm(reference[bin]);
+                errorPower += error;
+                if(error > worstError) worstError = error;
+            }
+            double snr = 10 * log10(signalPower / (errorPower + 1e-12));
+            double fullScale = (double)SPECTRUM_INPUT_LIMIT / 4;
+            double binError = 10 * log10(worstError / (fullScale * fullScale) + 1e-12);
+            bool ok = binError <= MAX_BIN_ERROR_DB;
+
+            // Tones must be read back at their frequency. Interval 1000 ns gives bins of 1e6 / points Hz.
+            char peakText[16] = "-";
+            if(strcmp(signal, "noise") != 0)
+            {
+                double peakBins = spectrum.peakMilliHertz() / 1000.0 / (1e6 / points);
+                double peakError = peakBins - cycles;
+                snprintf(peakText, sizeof(peakText), "%+.3f", peakError);
+                if(fabs(peakError) > MAX_PEAK_ERROR_BINS) ok = false;
+            }
+            printf("%-6u %-12s %10.1f %14.1f %12s%s\n", points, signal, snr, binError, peakText, ok? "": "  FAIL");
+            passed = passed && ok;
+        }
+    }
+
+    // Timing - the transform only, and the whole block as the display computes it
+    printf("\n%-6s %14s %14s\n", "points", "fft us", "spectrum us");
+    for(uint8_t bits = SPECTRUM_MIN_BITS; bits <= SPECTRUM_MAX_BITS; bits++)
+    {
+        uint16_t points = 1 << bits;
+        makeSignal("two tone", samples, points, points / 16 + 0.37, bits);
+        double results[2];
+        for(int pass = 0; pass < 2; pass++)
+        {
+            uint32_t runs = 0;
+            auto start = std::chrono::steady_clock::now();
+            double elapsed = 0;
+            while(elapsed < BENCH_SECONDS)
+            {
+                for(int repeat = 0; repeat < 100; repeat++)
+                {
+                    if(pass == 0)
+                    {
+                        for(uint16_t index = 0; index < points; index++)
+                        {
+                            re[index] = (samples[index] - 2048) << SPECTRUM_INPUT_SHIFT;
+                            im[index] = 0;
+                        }
+                        fftQ15(re, im, bits);
+                    }
+                    else spectrum.compute(samples, points, 1000);
+                }
+                runs += 100;
+                elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+            results[pass] = elapsed * 1e6 / runs;
+        }
+        printf("%-6u %14.2f %14.2f\n", points, results[0], results[1]);
+    }
+
+    printf("\n%s\n", passed? "All checks passed": "Checks FAILED");
+    return passed? 0: 1;
+}
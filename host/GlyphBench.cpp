@@ -0,0 +1,137 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Checks the glyph cache (see GlyphCache.h) against the ssd1306 library's text drawing, and times both.
+// Each string is drawn both ways at scales 1 and 2, on and off page boundaries and clipped at the edges,
+// and the framebuffers must match. Then the cost per string is timed for the readouts the display shows.
+// Times are for the host, so only the ratio says much about the RP2040. Exits with 1 if any check fails.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <initializer_list>
+extern "C"
+{
+    #include "ssd1306.h"
+}
+#include "GlyphCache.h"
+#include "HostCheck.h"
+
+#define WIDTH           128
+#define HEIGHT          32
+#define BENCH_SECONDS   0.1     // Time spent timing each string and method
+
+static uint8_t libraryBuffer[WIDTH * HEIGHT / 8];
+static uint8_t cacheBuffer[WIDTH * HEIGHT / 8];
+static ssd1306_t display;
+
+// Strings like the ones the display draws, and every character in the font
+static const char *strings[] = { "2.5 volts", "12.35 KHz", "ROLL", "5ms", "Vpp 4.98", "All characters", NULL };
+static char allCharacters[GLYPH_COUNT + 1];
+
+static void drawWithLibrary(uint32_t x, uint32_t y, uint32_t scale, const char *s)
+{
+    display.buffer = libraryBuffer;
+    ssd1306_draw_string(&display, x, y, scale, s);
+}
+
+static void drawWithCache(uint32_t x, uint32_t y, uint32_t scale, const char *s)
+{
+    drawGlyphString(cacheBuffer, WIDTH, HEIGHT, x, y, scale, s);
+}
+
+static void compareString(uint32_t x, uint32_t y, uint32_t scale, const char *s)
+{
+    memset(libraryBuffer, 0x24, sizeof(libraryBuffer));    // Text is ORed over what is there
+    memset(cacheBuffer, 0x24, sizeof(cacheBuffer));
+    drawWithLibrary(x, y, scale, s);
+    drawWithCache(x, y, scale, s);
+    for(uint32_t index = 0; index < sizeof(libraryBuffer); index++)
+    {
+        if(libraryBuffer[index] != cacheBuffer[index])
+        {
+            CHECK(false, "\"%.16s\" at %u,%u scale %u: page %u column %u is %02x, the library drew %02x", s, x, y, scale,
+                index / WIDTH, index % WIDTH, cacheBuffer[index], libraryBuffer[index]);
+            return;
+        }
+    }
+}
+
+static void testOutput()
+{
+    for(uint8_t scale : {1, 2})
+    {
+        for(const char **s = strings; *s; s++)
+        {
+            for(uint32_t y = 0; y < HEIGHT; y++) compareString(2, y, scale, *s);
+            for(uint32_t x : {0, 50, 100, 125, 127}) compareString(x, 3, scale, *s);
+        }
+        for(uint32_t offset = 0; offset < GLYPH_COUNT; offset += 128 / (6 * scale))
+        {
+            for(uint32_t y : {0, 5, 8, 13, 24, 30}) compareString(0, y, scale, allCharacters + offset);
+        }
+        compareString(0, 0, scale, "\x01\x1f\x7f\xff tab\tand high");    // Characters outside the font are skipped
+    }
+    CHECK(!drawGlyphString(cacheBuffer, WIDTH, HEIGHT, 0, 0, 3, "x"), "scale 3 should be left to the library");
+}
+
+// Average microseconds to draw s
+static double timeString(void (*draw)(uint32_t, uint32_t, uint32_t, const char *), uint32_t y, uint32_t scale, const char *s)
+{
+    uint32_t runs = 0;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0;
+    while(elapsed < BENCH_SECONDS)
+    {
+        for(int repeat = 0; repeat < 100; repeat++) draw(2, y, scale, s);
+        runs += 100;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    return elapsed * 1e6 / runs;
+}
+
+static void benchmark()
+{
+    printf("%-16s %5s %3s %12s %12s %8s\n", "string", "scale", "y", "library us", "cache us", "speedup");
+    for(uint8_t scale : {1, 2})
+    {
+        for(uint32_t y : {8, 11})
+        {
+            for(const char **s = strings; *s; s++)
+            {
+                double library = timeString(drawWithLibrary, y, scale, *s);
+                double cache = timeString(drawWithCache, y, scale, *s);
+                printf("%-16.16s %5u %3u %12.3f %12.3f %7.1fx\n", *s, scale, y, library, cache, library / cache);
+            }
+        }
+    }
+}
+
+int main()
+{
+    for(uint8_t index = 0; index < GLYPH_COUNT; index++) allCharacters[index] = GLYPH_FIRST + index;
+    display.width = WIDTH;
+    display.height = HEIGHT;
+    display.pages = HEIGHT / 8;
+    display.bufsize = sizeof(libraryBuffer);
+
+    testOutput();
+    benchmark();
+    return checkResult("Glyph cache");
+}
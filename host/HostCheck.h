@@ -0,0 +1,48 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __HOSTCHECK_H__
+#define __HOSTCHECK_H__
+
+// Minimal checks for the host tests. A failed check prints where it is and what went wrong, and carries
+// on so one run shows every failure. The test's main returns checkResult().
+
+#include <stdio.h>
+
+static int checkFailures = 0;
+
+#define CHECK(condition, ...) \
+    do \
+    { \
+        if(!(condition)) \
+        { \
+            checkFailures++; \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+        } \
+    } while(0)
+
+// Exit status for the test: 0 if every check passed
+inline int checkResult(const char *name)
+{
+    printf("%s: %s\n", name, (checkFailures == 0)? "all checks passed": "checks FAILED");
+    return (checkFailures == 0)? 0: 1;
+}
+
+#endif
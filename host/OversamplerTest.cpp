@@ -0,0 +1,158 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Checks the voltmeter's oversampling (see Oversampler.h). Blocks of synthetic readings - a level between
+// ADC codes plus seeded gaussian noise, rounded to 12 bits as the ADC would - go through oversample, and
+// the 14 bit mean, peak and low must land within bounds of the true level. Also checks that a partial
+// group at the end is ignored and that bits above the 12 bit reading are masked off.
+// Exits with 1 if any check fails.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include <random>
+#include <initializer_list>
+#include "Oversampler.h"
+#include "HostCheck.h"
+
+#define BLOCK_READINGS      4096    // The voltmeter's burst
+#define MAX_SIGMAS          5.0     // How far the mean, peak and low may stray, in standard deviations of each
+
+static uint16_t samples[UINT16_MAX];
+
+// Fill count readings of level (in 12 bit counts) with gaussian noise of sigma counts
+static void makeReadings(uint16_t count, double level, double sigma, uint32_t seed)
+{
+    std::mt19937 generator(seed);
+    std::normal_distribution<double> noise(0, sigma);
+    for(uint16_t index = 0; index < count; index++)
+    {
+        double reading = round(level + noise(generator));
+        samples[index] = (reading < 0)? 0: (reading > OVERSAMPLE_MASK)? OVERSAMPLE_MASK: reading;
+    }
+}
+
+static bool sameReading(const PrecisionReading &a, const PrecisionReading &b)
+{
+    return a.mean == b.mean && a.peak == b.peak && a.low == b.low && a.count == b.count;
+}
+
+// Noise of half a count and more dithers the readings, so the mean resolves better than a count.
+// Each reading's noise is sigma plus the ADC's rounding, in counts. Four times that is the noise in 14 bit
+// codes, so a group of 16 averages it to noise codes and the block of 4096 to noise / 16 codes. The mean,
+// peak and low must be within MAX_SIGMAS of that, plus half a code for their own rounding.
+static void testNoisyLevels()
+{
+    double worstMean = 0;
+    double worstPeak = 0;
+    double worstLow = 0;
+    uint32_t seed = 1;
+    for(double sigma : {0.5, 1.0, 2.0, 4.0})
+    {
+        double noise = sqrt(sigma * sigma + 1.0 / 12);
+        double meanSigma = noise * 4 / sqrt(BLOCK_READINGS);
+        double groupSigma = noise * 4 / sqrt(OVERSAMPLE_GROUP);
+        for(double level = 20; level < 4075; level += 37.0625)     // Steps through every sixteenth of a count
+        {
+            makeReadings(BLOCK_READINGS, level, sigma, seed++);
+            PrecisionReading reading = oversample(samples, BLOCK_READINGS);
+            double expected = level * 4;
+            double meanSigmas = (fabs(reading.mean - expected) - 0.5) / meanSigma;
+            double peakSigmas = (reading.peak - expected - 0.5) / groupSigma;
+            double lowSigmas = (expected - reading.low - 0.5) / groupSigma;
+            CHECK(reading.count == BLOCK_READINGS, "level %.4f: count %u", level, reading.count);
+            CHECK(meanSigmas <= MAX_SIGMAS, "level %.4f sigma %.1f: mean %u is %.1f sigma from %.2f",
+                level, sigma, reading.mean, meanSigmas, expected);
+            CHECK(reading.low <= reading.mean && reading.mean <= reading.peak, "level %.4f sigma %.1f: low %u mean %u peak %u out of order",
+                level, sigma, reading.low, reading.mean, reading.peak);
+            // Across 256 groups the extremes are always beyond the level
+            CHECK(reading.peak > expected && peakSigmas <= MAX_SIGMAS, "level %.4f sigma %.1f: peak %u is %.1f sigma from %.2f",
+                level, sigma, reading.peak, peakSigmas, expected);
+            CHECK(reading.low < expected && lowSigmas <= MAX_SIGMAS, "level %.4f sigma %.1f: low %u is %.1f sigma from %.2f",
+                level, sigma, reading.low, lowSigmas, expected);
+            if(meanSigmas > worstMean) worstMean = meanSigmas;
+            if(peakSigmas > worstPeak) worstPeak = peakSigmas;
+            if(lowSigmas > worstLow) worstLow = lowSigmas;
+        }
+    }
+    printf("worst mean %.1f sigma, peak %.1f sigma, low %.1f sigma\n", worstMean, worstPeak, worstLow);
+}
+
+// Without noise every value is the reading, four times over
+static void testQuietLevels()
+{
+    for(uint16_t level : {0, 1, 1000, 2047, 4094, 4095})
+    {
+        for(uint16_t index = 0; index < BLOCK_READINGS; index++) samples[index] = level;
+        PrecisionReading reading = oversample(samples, BLOCK_READINGS);
+        CHECK(reading.mean == level * 4 && reading.peak == level * 4 && reading.low == level * 4,
+            "steady %u: mean %u peak %u low %u", level, reading.mean, reading.peak, reading.low);
+    }
+    // The largest block at full scale doesn't overflow
+    for(uint32_t index = 0; index < UINT16_MAX; index++) samples[index] = OVERSAMPLE_MASK;
+    PrecisionReading reading = oversample(samples, UINT16_MAX);
+    CHECK(reading.mean == 16380 && reading.peak == 16380 && reading.count == UINT16_MAX / OVERSAMPLE_GROUP * OVERSAMPLE_GROUP,
+        "full scale block: mean %u peak %u count %u", reading.mean, reading.peak, reading.count);
+}
+
+// Readings after the last whole group are ignored, and a block shorter than a group is no reading
+static void testPartialGroup()
+{
+    makeReadings(BLOCK_READINGS, 1234.3, 1.0, 99);
+    PrecisionReading whole = oversample(samples, BLOCK_READINGS);
+    for(uint16_t extra = 1; extra < OVERSAMPLE_GROUP; extra++)
+    {
+        for(uint16_t index = 0; index < extra; index++) samples[BLOCK_READINGS + index] = (index & 1)? 0: OVERSAMPLE_MASK;
+        PrecisionReading reading = oversample(samples, BLOCK_READINGS + extra);
+        CHECK(sameReading(reading, whole), "%u readings past the last group changed the result", extra);
+    }
+    for(uint16_t count : {0, 1, OVERSAMPLE_GROUP - 1})
+    {
+        PrecisionReading reading = oversample(samples, count);
+        CHECK(reading.count == 0 && reading.mean == 0, "%u readings: count %u mean %u, expected no reading", count, reading.count, reading.mean);
+    }
+    // One group is its own mean, peak and low
+    for(uint16_t index = 0; index < OVERSAMPLE_GROUP; index++) samples[index] = 100 + (index & 1);    // 100.5
+    PrecisionReading reading = oversample(samples, OVERSAMPLE_GROUP);
+    CHECK(reading.count == OVERSAMPLE_GROUP && reading.mean == 402 && reading.peak == 402 && reading.low == 402,
+        "one group: count %u mean %u peak %u low %u, expected 402", reading.count, reading.mean, reading.peak, reading.low);
+}
+
+// Bits above the 12 bit reading - such as the ADC FIFO's error flag in bit 15 - don't reach the result
+static void testMask()
+{
+    makeReadings(BLOCK_READINGS, 3000.6, 1.5, 7);
+    PrecisionReading clean = oversample(samples, BLOCK_READINGS);
+    for(uint16_t high : {0x1000, 0x8000, 0xF000})
+    {
+        for(uint16_t index = 0; index < BLOCK_READINGS; index += 3) samples[index] |= high;
+        PrecisionReading reading = oversample(samples, BLOCK_READINGS);
+        CHECK(sameReading(reading, clean), "readings with %04x set: mean %u peak %u low %u, expected mean %u peak %u low %u",
+            high, reading.mean, reading.peak, reading.low, clean.mean, clean.peak, clean.low);
+        for(uint16_t index = 0; index < BLOCK_READINGS; index += 3) samples[index] &= OVERSAMPLE_MASK;
+    }
+}
+
+int main()
+{
+    testNoisyLevels();
+    testQuietLevels();
+    testPartialGroup();
+    testMask();
+    return checkResult("Oversampler");
+}
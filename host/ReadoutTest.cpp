@@ -0,0 +1,107 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Checks the integer readouts in Readout.h against the floating point code they replaced.
+// Every 10 bit ADC code must give the same "%.1f volts" text through the millivolt table and formatFixed
+// as it did through the float conversion and std::round. Exits with 1 if any check fails.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <cmath>
+#include "Readout.h"
+#include "HostCheck.h"
+
+// The voltage conversion as it was in Scope::getVoltageFromADCValue, float and all
+static float floatVoltage(uint16_t adcvalue)
+{
+    float topOfRange = 3.3 * (R1 + R2) / R2;
+    float actualVoltage = (adcvalue - 10) * topOfRange / (1023-20);
+    if(actualVoltage<0) actualVoltage = 0;
+    if(actualVoltage>topOfRange) actualVoltage = topOfRange;
+    return std::round(actualVoltage * 10) / 10;
+}
+
+static void testVoltageReadout()
+{
+    uint16_t mismatches = 0;
+    for(uint16_t code = 0; code < ADC_CODES; code++)
+    {
+        char expected[16];
+        char actual[16];
+        snprintf(expected, sizeof(expected), "%.1f volts", floatVoltage(code));
+        formatFixed(actual, adcToMillivolts(code), 3, 1, " volts");
+        if(strcmp(expected, actual) != 0 && mismatches++ < 10)
+        {
+            CHECK(false, "code %u: \"%s\", expected \"%s\"", code, actual, expected);
+        }
+        // The table is truncated, so it is never above the exact voltage
+        double exact = (code - 10) * TOP_OF_RANGE / (1023-20);
+        if(exact < 0) exact = 0;
+        if(exact > TOP_OF_RANGE) exact = TOP_OF_RANGE;
+        CHECK(adcMillivolts.millivolts[code] <= exact * 1000 && adcMillivolts.millivolts[code] > exact * 1000 - 1,
+            "code %u: %u mV, exact %.4f", code, adcMillivolts.millivolts[code], exact * 1000);
+    }
+    CHECK(mismatches == 0, "%u of %u codes read differently", mismatches, ADC_CODES);
+    CHECK(adcToMillivolts(ADC_CODES + 5) == adcMillivolts.millivolts[ADC_CODES - 1], "out of range code not clamped");
+}
+
+// The 14 bit oversampled conversion rounds where the table truncates, so at whole counts it is the table or one more
+static void testPrecisionMillivolts()
+{
+    for(uint16_t code = 0; code < ADC_CODES; code++)
+    {
+        int32_t difference = precisionToMillivolts(code * 16) - adcMillivolts.millivolts[code];
+        CHECK(difference == 0 || difference == 1, "code %u: %u mV oversampled, %u mV from the table",
+            code, precisionToMillivolts(code * 16), adcMillivolts.millivolts[code]);
+    }
+    CHECK(precisionToMillivolts(UINT16_MAX) == TOP_OF_RANGE_MV, "oversampled code not clamped to the top of the range");
+}
+
+static void checkFormat(uint32_t value, uint8_t scaleDigits, uint8_t decimals, const char *suffix, const char *expected)
+{
+    char actual[24];
+    formatFixed(actual, value, scaleDigits, decimals, suffix);
+    CHECK(strcmp(actual, expected) == 0, "formatFixed(%u, %u, %u): \"%s\", expected \"%s\"", value, scaleDigits, decimals, actual, expected);
+}
+
+static void testFormatFixed()
+{
+    checkFormat(0, 3, 1, " volts", "0.0 volts");
+    checkFormat(49, 3, 1, "", "0.0");
+    checkFormat(50, 3, 1, "", "0.1");           // Half rounds up
+    checkFormat(5, 3, 3, " Hz", "0.005 Hz");    // Leading zeros after the point
+    checkFormat(999, 0, 0, " Hz", "999 Hz");
+    checkFormat(12345, 3, 2, " KHz", "12.35 KHz");
+    checkFormat(999995, 3, 2, " KHz", "1000.00 KHz");   // Rounding carries into a new digit
+    checkFormat(4294967295u, 6, 3, " MHz", "4294.967 MHz");
+
+    char buffer[16];
+    const char *unit = formatTimeSpan(buffer, 2500000);
+    CHECK(strcmp(buffer, "2.5") == 0 && strcmp(unit, "ms") == 0, "2500000 ns: \"%s %s\"", buffer, unit);
+    unit = formatTimeSpan(buffer, 1000000000);
+    CHECK(strcmp(buffer, "1") == 0 && strcmp(unit, "sec") == 0, "1 sec: \"%s %s\"", buffer, unit);
+}
+
+int main()
+{
+    testVoltageReadout();
+    testPrecisionMillivolts();
+    testFormatFixed();
+    return checkResult("Readout");
+}
@@ -0,0 +1,103 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __SIGNALGENERATOR_H__
+#define __SIGNALGENERATOR_H__
+
+// Synthetic input signal for the host simulator. The signal is a pure function of time, so the ADC,
+// the DMA engine and the edge counter all see the same waveform no matter what order they read it in,
+// and a run with the same settings always produces the same results.
+
+#include <stdint.h>
+#include <math.h>
+#include "Readout.h"
+
+#define GPIO_LOW_VOLTS      0.8     // RP2040 input thresholds at 3.3V IOVDD
+#define GPIO_HIGH_VOLTS     2.0
+#define ADC_REFERENCE_VOLTS 3.3
+
+enum class Waveform { sine, square, pwm, noise, dc };
+
+class SignalGenerator
+{
+    public:
+        Waveform waveform = Waveform::sine;
+        double frequency = 1000;        // Hz
+        double lowVolts = 0;            // Bottom of the waveform at the input jack
+        double highVolts = 5;           // Top of the waveform. DC is held at this level.
+        double dutyPercent = 50;        // Time high for pwm
+        double noiseVolts = 0;          // Peak uniform noise added to every waveform
+        uint32_t seed = 1;
+
+        // Voltage at the input jack
+        double voltage(uint64_t timeNs)
+        {
+            double phase = fmod(timeNs * frequency / 1e9, 1.0);
+            double swing = highVolts - lowVolts;
+            double result;
+            switch(waveform)
+            {
+                case Waveform::sine: result = lowVolts + swing * (0.5 + 0.5 * sin(2 * M_PI * phase));
+                break;
+                case Waveform::square: result = (phase < 0.5)? highVolts: lowVolts;
+                break;
+                case Waveform::pwm: result = (phase < dutyPercent / 100)? highVolts: lowVolts;
+                break;
+                case Waveform::noise: result = lowVolts + swing * random(timeNs, 0);
+                break;
+                default: result = highVolts;
+                break;
+            }
+            if(noiseVolts > 0) result += noiseVolts * (2 * random(timeNs, 1) - 1);
+            return result;
+        }
+
+        // 12 bit ADC reading after the input voltage divider
+        uint16_t adcCode(uint64_t timeNs)
+        {
+            double pinVolts = voltage(timeNs) * R2 / (R1 + R2);
+            double code = pinVolts / ADC_REFERENCE_VOLTS * 4096;
+            if(code < 0) return 0;
+            if(code > 4095) return 4095;
+            return (uint16_t)code;
+        }
+
+        // Rising edges a GPIO behind the same divider has seen since time zero. Periodic waveforms that
+        // swing through both logic thresholds give one edge per period. Noise and DC give none.
+        uint64_t risingEdges(uint64_t timeNs)
+        {
+            if(waveform == Waveform::noise || waveform == Waveform::dc) return 0;
+            double pinLow = lowVolts * R2 / (R1 + R2);
+            double pinHigh = highVolts * R2 / (R1 + R2);
+            if(pinLow > GPIO_LOW_VOLTS || pinHigh < GPIO_HIGH_VOLTS) return 0;
+            return (uint64_t)(timeNs * frequency / 1e9);
+        }
+
+    private:
+        // Repeatable value in [0, 1) for a time and stream
+        double random(uint64_t timeNs, uint32_t stream)
+        {
+            uint64_t x = timeNs * 0x9E3779B97F4A7C15ULL + seed * 0xBF58476D1CE4E5B9ULL + stream;
+            x ^= x >> 31;
+            x *= 0x94D049BB133111EBULL;
+            x ^= x >> 29;
+            return (x >> 11) * (1.0 / 9007199254740992.0);
+        }
+};
+
+#endif
@@ -0,0 +1,835 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Core switches jump between stacks, which the fortified longjmp refuses to do
+#undef _FORTIFY_SOURCE
+#include <ucontext.h>
+#include <setjmp.h>
+#include <poll.h>
+#include <unistd.h>
+#include <string.h>
+#include <vector>
+#include "SimHal.h"
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "hardware/i2c.h"
+#include "hardware/irq.h"
+#include "hardware/pwm.h"
+#include "hardware/watchdog.h"
+#include "pico/stdio_usb.h"
+
+#define NEVER       UINT64_MAX
+#define NUM_GPIOS   30
+#define NUM_IRQS    32
+#define NUM_SLICES  8
+
+static uint64_t nowNs = 0;
+static uint currentCore = 0;
+static SignalGenerator generator;
+static SimPanel panel;
+static SimStats stats;
+
+uint64_t simTimeNs() { return nowNs; }
+SignalGenerator &simSignal() { return generator; }
+SimPanel &simPanel() { return panel; }
+SimStats &simStats() { return stats; }
+
+// ---- Cores
+
+// Core1 is started once with makecontext. After that the cores switch with _setjmp/_longjmp,
+// which unlike swapcontext do not make a system call to save the signal mask.
+static ucontext_t core0Context;
+static ucontext_t core1Context;
+static jmp_buf core0Jump;
+static jmp_buf core1Jump;
+static void (*core1Entry)(void) = NULL;
+static bool core1Running = false;
+static bool core1Started = false;
+static std::vector<uint8_t> core1Stack;
+
+static void core1Start()
+{
+    core1Entry();
+    core1Running = false;
+    _longjmp(core0Jump, 1);
+}
+
+void multicore_launch_core1(void (*entry)(void))
+{
+    core1Entry = entry;
+    core1Stack.resize(SIM_CORE1_STACK);
+    getcontext(&core1Context);
+    core1Context.uc_stack.ss_sp = core1Stack.data();
+    core1Context.uc_stack.ss_size = core1Stack.size();
+    core1Context.uc_link = NULL;
+    makecontext(&core1Context, core1Start, 0);
+    core1Running = true;
+}
+
+void simRunCore1()
+{
+    if(!core1Running || currentCore == 1) return;
+    stats.core1Slices++;
+    currentCore = 1;
+    if(!_setjmp(core0Jump))
+    {
+        if(core1Started) _longjmp(core1Jump, 1);
+        core1Started = true;
+        swapcontext(&core0Context, &core1Context);
+    }
+    currentCore = 0;
+}
+
+uint get_core_num(void)
+{
+    return currentCore;
+}
+
+// Core0 spends time busy: core1 keeps getting turns and interrupts fall due as the time passes
+static void core0Wait(uint64_t ns)
+{
+    uint64_t until = nowNs + ns;
+    while(nowNs < until)
+    {
+        simRunCore1();
+        uint64_t slice = SIM_WAIT_SLICE_US * 1000ULL;
+        simAdvanceTo((until - nowNs < slice)? until: nowNs + slice);
+    }
+}
+
+void tight_loop_contents(void)
+{
+    if(currentCore == 1)
+    {
+        if(!_setjmp(core1Jump)) _longjmp(core0Jump, 1);
+        return;
+    }
+    core0Wait(1000);
+}
+
+void sleep_us(uint64_t us)
+{
+    uint64_t until = nowNs + us * 1000;
+    if(currentCore == 0) core0Wait(us * 1000);
+    else while(nowNs < until) tight_loop_contents();
+}
+
+void sleep_ms(uint32_t ms)
+{
+    sleep_us(ms * 1000ULL);
+}
+
+uint64_t time_us_64(void)
+{
+    return nowNs / 1000;
+}
+
+void stdio_init_all(void)
+{
+}
+
+// The firmware asks every pass of its loop. Looking at the real stdin once per virtual millisecond
+// keeps the system calls from dominating the run. Whatever has arrived by then is buffered.
+int getchar_timeout_us(uint32_t timeout_us)
+{
+    static uint8_t input[256];
+    static ssize_t inputLength = 0;
+    static ssize_t inputPosition = 0;
+    static uint64_t nextCheckNs = 0;
+    if(inputPosition < inputLength) return input[inputPosition++];
+    if(nowNs < nextCheckNs) return PICO_ERROR_TIMEOUT;
+    nextCheckNs = nowNs + 1000000;
+    struct pollfd ready = { STDIN_FILENO, POLLIN, 0 };
+    if(poll(&ready, 1, 0) <= 0) return PICO_ERROR_TIMEOUT;
+    inputLength = read(STDIN_FILENO, input, sizeof(input));
+    inputPosition = 0;
+    if(inputLength <= 0) return PICO_ERROR_TIMEOUT;
+    return input[inputPosition++];
+}
+
+// ---- USB
+
+static FILE *usbOutput = NULL;
+
+void simSetUsbOutput(FILE *out)
+{
+    usbOutput = out;
+}
+
+bool stdio_usb_connected(void)
+{
+    return usbOutput != NULL;
+}
+
+int stdio_put_string(const char *s, int len, bool newline, bool cr_translation)
+{
+    if(!usbOutput) return len;
+    fwrite(s, 1, len, usbOutput);
+    stats.usbBytes += len;
+    core0Wait((uint64_t)len * SIM_USB_BYTE_NS);
+    return len;
+}
+
+// ---- Interrupts
+
+static irq_handler_t irqHandlers[NUM_IRQS];
+static bool irqEnabled[NUM_IRQS];
+static uint irqCore[NUM_IRQS];      // Interrupts run on the core that enabled them
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler)
+{
+    irqHandlers[num] = handler;
+}
+
+void irq_set_enabled(uint num, bool enabled)
+{
+    irqEnabled[num] = enabled;
+    irqCore[num] = currentCore;
+}
+
+static void raiseIrq(uint num)
+{
+    if(!irqEnabled[num] || !irqHandlers[num]) return;
+    uint interruptedCore = currentCore;
+    currentCore = irqCore[num];
+    irqHandlers[num]();
+    currentCore = interruptedCore;
+}
+
+// ---- Alarms
+
+struct alarm_pool
+{
+    uint core;
+};
+
+typedef struct SimAlarmStruct
+{
+    struct repeating_timer *timer;
+    uint64_t targetNs;      // When the alarm is scheduled
+    uint64_t fireNs;        // When it actually fires
+    uint core;
+} SimAlarm;
+
+static alarm_pool_t defaultPool = { 0 };
+static std::vector<alarm_pool_t *> pools;
+static std::vector<SimAlarm> alarms;
+static int32_t nextAlarmId = 1;
+static uint32_t alarmLatencyNs = 0;
+static uint32_t latencySeed = 1;
+
+void simSetAlarmLatency(uint32_t maxUs)
+{
+    alarmLatencyNs = maxUs * 1000;
+}
+
+// Repeatable pseudo random delay up to the latency setting
+static uint64_t alarmLatency()
+{
+    if(alarmLatencyNs == 0) return 0;
+    latencySeed = latencySeed * 1664525 + 1013904223;
+    return (latencySeed >> 8) % (alarmLatencyNs + 1);
+}
+
+alarm_pool_t *alarm_pool_create_with_unused_hardware_alarm(uint max_timers)
+{
+    alarm_pool_t *pool = new alarm_pool_t;
+    pool->core = currentCore;
+    pools.push_back(pool);
+    return pool;
+}
+
+bool alarm_pool_add_repeating_timer_us(alarm_pool_t *pool, int64_t delay_us, repeating_timer_callback_t callback, void *user_data, struct repeating_timer *out)
+{
+    if(delay_us == 0) return false;
+    out->delay_us = delay_us;
+    out->pool = pool;
+    out->alarm_id = nextAlarmId++;
+    out->callback = callback;
+    out->user_data = user_data;
+    uint64_t delayNs = (delay_us < 0? -delay_us: delay_us) * 1000ULL;
+    alarms.push_back({ out, nowNs + delayNs, nowNs + delayNs + alarmLatency(), pool->core });
+    return true;
+}
+
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback, void *user_data, struct repeating_timer *out)
+{
+    return alarm_pool_add_repeating_timer_us(&defaultPool, delay_us, callback, user_data, out);
+}
+
+static int findAlarm(struct repeating_timer *timer)
+{
+    for(size_t index = 0; index < alarms.size(); index++)
+    {
+        if(alarms[index].timer == timer) return index;
+    }
+    return -1;
+}
+
+bool cancel_repeating_timer(struct repeating_timer *timer)
+{
+    int index = findAlarm(timer);
+    if(index < 0) return false;
+    alarms.erase(alarms.begin() + index);
+    return true;
+}
+
+static void fireAlarm(size_t index)
+{
+    struct repeating_timer *timer = alarms[index].timer;
+    uint interruptedCore = currentCore;
+    currentCore = alarms[index].core;
+    bool repeat = timer->callback(timer);
+    currentCore = interruptedCore;
+    stats.alarmCallbacks++;
+
+    // The callback may have added or cancelled timers
+    int current = findAlarm(timer);
+    if(current < 0) return;
+    if(!repeat)
+    {
+        alarms.erase(alarms.begin() + current);
+        return;
+    }
+    // Negative delays are measured from the previous target, positive ones from the end of the callback.
+    // A target that has already passed fires straight away.
+    SimAlarm &alarm = alarms[current];
+    if(timer->delay_us < 0) alarm.targetNs += -timer->delay_us * 1000ULL;
+    else alarm.targetNs = nowNs + timer->delay_us * 1000ULL;
+    alarm.fireNs = alarm.targetNs + alarmLatency();
+    if(alarm.fireNs < nowNs) alarm.fireNs = nowNs;
+}
+
+// ---- GPIO
+
+static bool gpioLevel[NUM_GPIOS];
+static bool gpioOutput[NUM_GPIOS];
+static bool gpioDriven[NUM_GPIOS];     // Held by the simulator
+static enum gpio_function gpioFunction[NUM_GPIOS];
+
+void gpio_init(uint gpio)
+{
+    gpioFunction[gpio] = GPIO_FUNC_SIO;
+    gpioOutput[gpio] = false;
+    if(!gpioDriven[gpio]) gpioLevel[gpio] = false;
+}
+
+void gpio_set_dir(uint gpio, bool out)
+{
+    gpioOutput[gpio] = out;
+}
+
+void gpio_set_function(uint gpio, enum gpio_function fn)
+{
+    gpioFunction[gpio] = fn;
+}
+
+void gpio_pull_up(uint gpio)
+{
+    if(!gpioDriven[gpio] && !gpioOutput[gpio]) gpioLevel[gpio] = true;
+}
+
+void gpio_pull_down(uint gpio)
+{
+    if(!gpioDriven[gpio] && !gpioOutput[gpio]) gpioLevel[gpio] = false;
+}
+
+void gpio_put(uint gpio, bool value)
+{
+    if(gpioOutput[gpio]) gpioLevel[gpio] = value;
+}
+
+bool gpio_get(uint gpio)
+{
+    return gpioLevel[gpio];
+}
+
+void simSetGpio(uint gpio, bool level)
+{
+    gpioDriven[gpio] = true;
+    gpioLevel[gpio] = level;
+}
+
+// ---- ADC
+
+static adc_hw_t adcRegisters;
+adc_hw_t *const adc_hw = &adcRegisters;
+static bool adcFifoEnabled = false;
+static bool adcDreqEnabled = false;
+static bool adcRunning = false;
+static float adcClkdiv = 0;
+
+void adc_init(void)
+{
+}
+
+void adc_gpio_init(uint gpio)
+{
+    gpioFunction[gpio] = GPIO_FUNC_NULL;
+}
+
+void adc_select_input(uint input)
+{
+}
+
+uint16_t adc_read(void)
+{
+    stats.adcReads++;
+    return generator.adcCode(nowNs);
+}
+
+static uint64_t adcIntervalNs()
+{
+    double clocks = adcClkdiv + 1;
+    if(clocks < SIM_ADC_MIN_CLOCKS) clocks = SIM_ADC_MIN_CLOCKS;
+    return (uint64_t)(clocks * 1e9 / SIM_ADC_CLOCK_HZ + 0.5);
+}
+
+void adc_set_clkdiv(float clkdiv)
+{
+    adcClkdiv = clkdiv;
+}
+
+void adc_fifo_setup(bool en, bool dreq_en, uint16_t dreq_thresh, bool err_in_fifo, bool byte_shift)
+{
+    adcFifoEnabled = en;
+    adcDreqEnabled = dreq_en;
+}
+
+void adc_fifo_drain(void)
+{
+}
+
+static void startAdcTransfers();
+
+void adc_run(bool run)
+{
+    adcRunning = run;
+    if(run) startAdcTransfers();
+}
+
+// ---- DMA
+
+typedef struct SimDmaChannelStruct
+{
+    bool claimed = false;
+    bool busy = false;
+    bool irq0Enabled = false;
+    bool irq1Enabled = false;
+    dma_channel_config config = {};
+    volatile void *write = NULL;
+    const volatile void *read = NULL;
+    uint count = 0;
+    uint64_t startNs = 0;
+    uint64_t intervalNs = 0;
+    uint64_t endNs = NEVER;     // When the transfer completes. NEVER while waiting for its DREQ to start.
+} SimDmaChannel;
+
+// Config layout: size in bits 0-1, read increment bit 2, write increment bit 3, dreq in bits 4-9,
+// chain in bits 10-13. Address rings are accepted but not modelled - a transfer never outruns its buffer here.
+#define CONFIG_SIZE(c)          ((c).ctrl & 3)
+#define CONFIG_READ_INCR(c)     (((c).ctrl >> 2) & 1)
+#define CONFIG_WRITE_INCR(c)    (((c).ctrl >> 3) & 1)
+#define CONFIG_DREQ(c)          (((c).ctrl >> 4) & 0x3F)
+#define CONFIG_CHAIN(c)         (((c).ctrl >> 10) & 0xF)
+
+static SimDmaChannel dmaChannels[NUM_DMA_CHANNELS];
+static dma_hw_t dmaRegisters;
+dma_hw_t *const dma_hw = &dmaRegisters;
+
+static i2c_hw_t i2c0Registers;
+i2c_inst_t i2c0_inst = { &i2c0Registers };
+static std::vector<uint8_t> i2cTransaction;
+
+int dma_claim_unused_channel(bool required)
+{
+    for(int channel = 0; channel < NUM_DMA_CHANNELS; channel++)
+    {
+        if(!dmaChannels[channel].claimed)
+        {
+            dmaChannels[channel] = SimDmaChannel();
+            dmaChannels[channel].claimed = true;
+            return channel;
+        }
+    }
+    if(required)
+    {
+        fprintf(stderr, "No DMA channels are available\n");
+        abort();
+    }
+    return -1;
+}
+
+void dma_channel_unclaim(uint channel)
+{
+    dmaChannels[channel].claimed = false;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel)
+{
+    dma_channel_config config;
+    config.ctrl = DMA_SIZE_32 | (1 << 2) | (DREQ_FORCE << 4) | (channel << 10);     // Chained to itself is no chain
+    return config;
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size)
+{
+    c->ctrl = (c->ctrl & ~3u) | size;
+}
+
+void channel_config_set_read_increment(dma_channel_config *c, bool incr)
+{
+    c->ctrl = (c->ctrl & ~(1u << 2)) | (incr << 2);
+}
+
+void channel_config_set_write_increment(dma_channel_config *c, bool incr)
+{
+    c->ctrl = (c->ctrl & ~(1u << 3)) | (incr << 3);
+}
+
+void channel_config_set_dreq(dma_channel_config *c, uint dreq)
+{
+    c->ctrl = (c->ctrl & ~(0x3Fu << 4)) | (dreq << 4);
+}
+
+void channel_config_set_chain_to(dma_channel_config *c, uint chain_to)
+{
+    c->ctrl = (c->ctrl & ~(0xFu << 10)) | (chain_to << 10);
+}
+
+void channel_config_set_ring(dma_channel_config *c, bool write, uint size_bits)
+{
+}
+
+void dma_channel_set_irq0_enabled(uint channel, bool enabled)
+{
+    dmaChannels[channel].irq0Enabled = enabled;
+}
+
+void dma_channel_acknowledge_irq0(uint channel)
+{
+    dmaRegisters.ints0 &= ~(1u << channel);
+}
+
+void dma_channel_set_irq1_enabled(uint channel, bool enabled)
+{
+    dmaChannels[channel].irq1Enabled = enabled;
+}
+
+void dma_channel_acknowledge_irq1(uint channel)
+{
+    dmaRegisters.ints1 &= ~(1u << channel);
+}
+
+bool dma_channel_get_irq1_status(uint channel)
+{
+    return (dmaRegisters.ints1 >> channel) & 1;
+}
+
+void dma_channel_abort(uint channel)
+{
+    dmaChannels[channel].busy = false;
+    dmaChannels[channel].endNs = NEVER;
+}
+
+bool dma_channel_is_busy(uint channel)
+{
+    return dmaChannels[channel].busy;
+}
+
+static uint32_t readElement(const volatile void *base, uint size, uint index)
+{
+    switch(size)
+    {
+        case DMA_SIZE_8: return ((const volatile uint8_t *)base)[index];
+        case DMA_SIZE_16: return ((const volatile uint16_t *)base)[index];
+        default: return ((const volatile uint32_t *)base)[index];
+    }
+}
+
+static void writeElement(volatile void *base, uint size, uint index, uint32_t value)
+{
+    switch(size)
+    {
+        case DMA_SIZE_8: ((volatile uint8_t *)base)[index] = value;
+        break;
+        case DMA_SIZE_16: ((volatile uint16_t *)base)[index] = value;
+        break;
+        default: ((volatile uint32_t *)base)[index] = value;
+        break;
+    }
+}
+
+// Words written to the I2C data_cmd register. The low byte goes on the bus and STOP ends the transaction.
+static void i2cDataCommand(uint32_t word)
+{
+    i2cTransaction.push_back(word & 0xFF);
+    stats.i2cBytes++;
+    if(word & I2C_IC_DATA_CMD_STOP_BITS)
+    {
+        stats.i2cBytes++;   // Address byte
+        panel.transaction(i2cTransaction.data(), i2cTransaction.size());
+        i2cTransaction.clear();
+    }
+}
+
+// The ADC paces the transfer at one sample per conversion. The samples are taken from the signal when it completes.
+static void startAdcTransfers()
+{
+    if(!adcFifoEnabled || !adcDreqEnabled) return;
+    for(uint channel = 0; channel < NUM_DMA_CHANNELS; channel++)
+    {
+        SimDmaChannel &dma = dmaChannels[channel];
+        if(!dma.busy || dma.endNs != NEVER || CONFIG_DREQ(dma.config) != DREQ_ADC) continue;
+        dma.startNs = nowNs;
+        dma.intervalNs = adcIntervalNs();
+        dma.endNs = nowNs + dma.count * dma.intervalNs;
+    }
+}
+
+static void startTransfer(uint channel)
+{
+    SimDmaChannel &dma = dmaChannels[channel];
+    dma.busy = true;
+    dma.endNs = NEVER;
+    uint size = CONFIG_SIZE(dma.config);
+    switch(CONFIG_DREQ(dma.config))
+    {
+        case DREQ_ADC:
+            if(adcRunning) startAdcTransfers();
+        break;
+        case DREQ_I2C0_TX:
+            // The panel sees the data at once. The channel stays busy for as long as the bus would take.
+            for(uint index = 0; index < dma.count; index++)
+            {
+                i2cDataCommand(readElement(dma.read, size, CONFIG_READ_INCR(dma.config)? index: 0));
+            }
+            dma.endNs = nowNs + (uint64_t)dma.count * SIM_I2C_BYTE_NS;
+        break;
+        default:
+            for(uint index = 0; index < dma.count; index++)
+            {
+                uint32_t value = readElement(dma.read, size, CONFIG_READ_INCR(dma.config)? index: 0);
+                writeElement(dma.write, size, CONFIG_WRITE_INCR(dma.config)? index: 0, value);
+            }
+            dma.endNs = nowNs;
+        break;
+    }
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr, const volatile void *read_addr, uint transfer_count, bool trigger)
+{
+    SimDmaChannel &dma = dmaChannels[channel];
+    dma.config = *config;
+    dma.write = write_addr;
+    dma.read = read_addr;
+    dma.count = transfer_count;
+    if(trigger) startTransfer(channel);
+}
+
+void dma_channel_set_config(uint channel, const dma_channel_config *config, bool trigger)
+{
+    dmaChannels[channel].config = *config;
+    if(trigger) startTransfer(channel);
+}
+
+void dma_channel_set_write_addr(uint channel, volatile void *write_addr, bool trigger)
+{
+    dmaChannels[channel].write = write_addr;
+    if(trigger) startTransfer(channel);
+}
+
+void dma_channel_start(uint channel)
+{
+    startTransfer(channel);
+}
+
+static void completeTransfer(uint channel)
+{
+    SimDmaChannel &dma = dmaChannels[channel];
+    if(CONFIG_DREQ(dma.config) == DREQ_ADC)
+    {
+        // Each conversion samples the signal as it starts
+        uint size = CONFIG_SIZE(dma.config);
+        bool increment = CONFIG_WRITE_INCR(dma.config);
+        for(uint index = 0; index < dma.count; index++)
+        {
+            writeElement(dma.write, size, increment? index: 0, generator.adcCode(dma.startNs + index * dma.intervalNs));
+        }
+        stats.adcDmaBlocks++;
+        stats.adcDmaSamples += dma.count;
+    }
+    dma.busy = false;
+    dma.endNs = NEVER;
+    // The chained channel starts before the interrupt is seen
+    uint chain = CONFIG_CHAIN(dma.config);
+    if(chain != channel) startTransfer(chain);
+    if(dma.irq0Enabled)
+    {
+        dmaRegisters.ints0 |= 1u << channel;
+        raiseIrq(DMA_IRQ_0);
+    }
+    if(dma.irq1Enabled)
+    {
+        dmaRegisters.ints1 |= 1u << channel;
+        raiseIrq(DMA_IRQ_1);
+    }
+}
+
+// ---- I2C
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate)
+{
+    i2c->hw->status = I2C_IC_STATUS_TFE_BITS;
+    return baudrate;
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop)
+{
+    panel.transaction(src, len);
+    stats.i2cBytes += len + 1;
+    core0Wait((len + 1) * SIM_I2C_BYTE_NS);
+    return len;
+}
+
+// ---- PWM edge counting
+
+typedef struct SimPwmSliceStruct
+{
+    bool enabled = false;
+    uint32_t csr = 0;
+    uint16_t counter = 0;       // Count when last set or stopped
+    uint64_t edgeBase = 0;      // Signal edges at that moment
+} SimPwmSlice;
+
+#define PWM_DIVMODE(csr)    (((csr) >> 4) & 3)
+
+static SimPwmSlice slices[NUM_SLICES];
+
+pwm_config pwm_get_default_config(void)
+{
+    pwm_config config;
+    config.csr = 0;
+    config.div = 1 << 4;
+    config.top = 0xFFFF;
+    return config;
+}
+
+void pwm_config_set_clkdiv_mode(pwm_config *c, enum pwm_clkdiv_mode mode)
+{
+    c->csr = (c->csr & ~(3u << 4)) | (mode << 4);
+}
+
+void pwm_config_set_clkdiv(pwm_config *c, float div)
+{
+    c->div = (uint32_t)(div * 16);
+}
+
+// Only the B pin in rising edge mode is modelled - that is all the edge counter uses
+static uint16_t sliceCount(uint slice)
+{
+    SimPwmSlice &pwm = slices[slice];
+    bool pinB = gpioFunction[slice * 2 + 1] == GPIO_FUNC_PWM || (slice * 2 + 17 < NUM_GPIOS && gpioFunction[slice * 2 + 17] == GPIO_FUNC_PWM);
+    if(!pwm.enabled || PWM_DIVMODE(pwm.csr) != PWM_DIV_B_RISING || !pinB) return pwm.counter;
+    return pwm.counter + (uint16_t)(generator.risingEdges(nowNs) - pwm.edgeBase);
+}
+
+void pwm_init(uint slice_num, pwm_config *c, bool start)
+{
+    slices[slice_num].csr = c->csr;
+    slices[slice_num].counter = 0;
+    slices[slice_num].enabled = start;
+    slices[slice_num].edgeBase = generator.risingEdges(nowNs);
+}
+
+void pwm_set_counter(uint slice_num, uint16_t c)
+{
+    slices[slice_num].counter = c;
+    slices[slice_num].edgeBase = generator.risingEdges(nowNs);
+}
+
+uint16_t pwm_get_counter(uint slice_num)
+{
+    return sliceCount(slice_num);
+}
+
+void pwm_set_enabled(uint slice_num, bool enabled)
+{
+    SimPwmSlice &pwm = slices[slice_num];
+    if(pwm.enabled == enabled) return;
+    pwm.counter = sliceCount(slice_num);
+    pwm.edgeBase = generator.risingEdges(nowNs);
+    pwm.enabled = enabled;
+}
+
+// ---- Watchdog
+
+bool watchdog_caused_reboot(void)
+{
+    return false;
+}
+
+void watchdog_enable(uint32_t delay_ms, bool pause_on_debug)
+{
+}
+
+void watchdog_update(void)
+{
+}
+
+// ---- Virtual time
+
+void simAdvanceTo(uint64_t timeNs)
+{
+    while(true)
+    {
+        // Find the next thing to fall due
+        uint64_t nextNs = NEVER;
+        int nextAlarm = -1;
+        int nextChannel = -1;
+        for(size_t index = 0; index < alarms.size(); index++)
+        {
+            if(alarms[index].fireNs < nextNs)
+            {
+                nextNs = alarms[index].fireNs;
+                nextAlarm = index;
+            }
+        }
+        for(int channel = 0; channel < NUM_DMA_CHANNELS; channel++)
+        {
+            if(dmaChannels[channel].busy && dmaChannels[channel].endNs < nextNs)
+            {
+                nextNs = dmaChannels[channel].endNs;
+                nextChannel = channel;
+                nextAlarm = -1;
+            }
+        }
+        if(nextNs > timeNs) break;
+        if(nextNs > nowNs) nowNs = nextNs;
+        if(nextChannel >= 0) completeTransfer(nextChannel);
+        else fireAlarm(nextAlarm);
+    }
+    if(timeNs > nowNs) nowNs = timeNs;
+}
+
+void simAdvanceUs(uint64_t us)
+{
+    simAdvanceTo(nowNs + us * 1000);
+}
@@ -0,0 +1,63 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __SIMHAL_H__
+#define __SIMHAL_H__
+
+// Control side of the stand-in Pico HAL. Time is virtual: it only moves when the simulator advances it,
+// and every alarm, DMA completion and interrupt falls due at an exact virtual time. Core1 runs as a
+// coroutine on its own stack and gets a turn each time the simulator calls simRunCore1 or core0 busy-waits.
+// Nothing runs in parallel, so a run is repeatable and as fast as the host can execute the firmware.
+
+#include <stdint.h>
+#include <stdio.h>
+#include "pico/types.h"
+#include "SignalGenerator.h"
+#include "SimPanel.h"
+
+#define SIM_ADC_CLOCK_HZ        48000000    // ADC clock
+#define SIM_ADC_MIN_CLOCKS      96          // Clocks per conversion
+#define SIM_I2C_BYTE_NS         22500       // 9 bit times at 400KHz
+#define SIM_USB_BYTE_NS         1000        // About what USB CDC sustains at full speed: 1 MB/s
+#define SIM_CORE1_STACK         (256 * 1024)
+#define SIM_WAIT_SLICE_US       10          // Core1 gets a turn this often while core0 busy-waits or sleeps
+
+typedef struct SimStatsStruct
+{
+    uint64_t alarmCallbacks = 0;    // Repeating timer callbacks run
+    uint64_t adcReads = 0;          // Single conversions through adc_read
+    uint64_t adcDmaBlocks = 0;      // ADC to memory DMA transfers completed
+    uint64_t adcDmaSamples = 0;
+    uint64_t i2cBytes = 0;          // Bytes on the display bus, including addresses
+    uint64_t usbBytes = 0;          // Bytes sent to the USB output
+    uint64_t core1Slices = 0;       // Times core1 was resumed
+} SimStats;
+
+uint64_t simTimeNs();
+void simAdvanceUs(uint64_t us);         // Move virtual time forward, running whatever falls due
+void simAdvanceTo(uint64_t timeNs);
+void simRunCore1();                     // Resume core1 until it next calls tight_loop_contents
+void simSetGpio(uint gpio, bool level); // Drive an input pin, for example a button
+void simSetAlarmLatency(uint32_t maxUs);    // Fire each timer alarm up to this late, as if interrupts were held off
+void simSetUsbOutput(FILE *out);        // Where binary USB output goes. USB is connected while this is set.
+
+SignalGenerator &simSignal();
+SimPanel &simPanel();
+SimStats &simStats();
+
+#endif
@@ -0,0 +1,128 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "SimPanel.h"
+
+#define CONTROL_COMMANDS    0x00
+#define CONTROL_DATA        0x40
+
+void SimPanel::transaction(const uint8_t *bytes, size_t length)
+{
+    if(length == 0) return;
+    if(bytes[0] == CONTROL_DATA)
+    {
+        // Horizontal addressing - the column wraps within the window and moves on to the next page
+        for(size_t index = 1; index < length; index++)
+        {
+            ram[page][column] = bytes[index];
+            if(column++ >= columnEnd)
+            {
+                column = columnStart;
+                if(page++ >= pageEnd) page = pageStart;
+            }
+        }
+        dataTransactions++;
+        dataBytes += length - 1;
+        return;
+    }
+    if(bytes[0] != CONTROL_COMMANDS) return;
+    size_t index = 1;
+    while(index < length)
+    {
+        uint8_t code = bytes[index++];
+        uint8_t count = argumentCount(code);
+        if(index + count > length) return;     // Truncated command
+        command(code, bytes + index);
+        index += count;
+    }
+}
+
+uint8_t SimPanel::argumentCount(uint8_t code)
+{
+    switch(code)
+    {
+        case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xD3: case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+            return 1;
+        case 0x21: case 0x22: case 0xA3:
+            return 2;
+        case 0x29: case 0x2A:
+            return 5;
+        case 0x26: case 0x27:
+            return 6;
+        default:
+            return 0;
+    }
+}
+
+void SimPanel::command(uint8_t code, const uint8_t *args)
+{
+    switch(code)
+    {
+        case 0x21:  // Column address window
+            columnStart = args[0] % PANEL_WIDTH;
+            columnEnd = args[1] % PANEL_WIDTH;
+            column = columnStart;
+        break;
+        case 0x22:  // Page address window
+            pageStart = args[0] % PANEL_PAGES;
+            pageEnd = args[1] % PANEL_PAGES;
+            page = pageStart;
+        break;
+        case 0xAE:
+            displayOn = false;
+        break;
+        case 0xAF:
+            displayOn = true;
+        break;
+    }
+}
+
+void SimPanel::dump(FILE *out, uint32_t height)
+{
+    fprintf(out, "+");
+    for(uint32_t x = 0; x < PANEL_WIDTH; x++) fprintf(out, "-");
+    fprintf(out, "+\n");
+    for(uint32_t y = 0; y < height; y += 2)
+    {
+        fprintf(out, "|");
+        for(uint32_t x = 0; x < PANEL_WIDTH; x++)
+        {
+            bool top = pixel(x, y);
+            bool bottom = y + 1 < height && pixel(x, y + 1);
+            fprintf(out, "%s", (top && bottom)? "█": top? "▀": bottom? "▄": " ");
+        }
+        fprintf(out, "|\n");
+    }
+    fprintf(out, "+");
+    for(uint32_t x = 0; x < PANEL_WIDTH; x++) fprintf(out, "-");
+    fprintf(out, "+\n");
+}
+
+bool SimPanel::writePbm(const char *path, uint32_t height)
+{
+    FILE *out = fopen(path, "w");
+    if(!out) return false;
+    fprintf(out, "P1\n%d %u\n", PANEL_WIDTH, height);
+    for(uint32_t y = 0; y < height; y++)
+    {
+        for(uint32_t x = 0; x < PANEL_WIDTH; x++) fputc(pixel(x, y)? '1': '0', out);
+        fputc('\n', out);
+    }
+    fclose(out);
+    return true;
+}
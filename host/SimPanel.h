@@ -0,0 +1,62 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __SIMPANEL_H__
+#define __SIMPANEL_H__
+
+// In-memory SSD1306. It decodes the I2C transactions the driver sends - whether written directly or
+// streamed by DMA - into display RAM, so the simulator shows exactly what the real panel would.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define PANEL_WIDTH     128
+#define PANEL_PAGES     8
+
+class SimPanel
+{
+    public:
+        // One complete I2C write: a control byte followed by commands or display data
+        void transaction(const uint8_t *bytes, size_t length);
+
+        // Print the visible rows as text, two pixel rows per line
+        void dump(FILE *out, uint32_t height);
+        // Write the visible rows as a portable bitmap
+        bool writePbm(const char *path, uint32_t height);
+
+        bool pixel(uint32_t x, uint32_t y) { return (ram[y >> 3][x] >> (y & 7)) & 1; }
+
+        uint32_t dataTransactions = 0;  // Writes that changed display RAM
+        uint64_t dataBytes = 0;
+        bool displayOn = false;
+
+    private:
+        void command(uint8_t code, const uint8_t *args);
+        uint8_t argumentCount(uint8_t code);
+
+        uint8_t ram[PANEL_PAGES][PANEL_WIDTH] = {};
+        uint8_t columnStart = 0;
+        uint8_t columnEnd = PANEL_WIDTH - 1;
+        uint8_t pageStart = 0;
+        uint8_t pageEnd = PANEL_PAGES - 1;
+        uint8_t column = 0;
+        uint8_t page = 0;
+};
+
+#endif
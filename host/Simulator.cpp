@@ -0,0 +1,194 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Runs the firmware on the host against the stand-in HAL and a synthetic input signal.
+// The main loop is the same as tinyscopepico.cpp, except that each pass costs a fixed amount of
+// virtual time and the mode button is pressed from the command line.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "SimHal.h"
+#include "Scope.h"
+
+extern "C"
+{
+    #include "ssd1306.h"
+}
+
+#define SIM_LOOP_US     10      // Virtual time one pass of the main loop takes
+
+ssd1306_t disp;
+
+static void usage()
+{
+    printf("Usage: bitscanner_sim [options]\n");
+    printf("  --wave sine|square|pwm|noise|dc   Input waveform (sine)\n");
+    printf("  --freq <Hz>                       Signal frequency (1000)\n");
+    printf("  --low <volts>                     Bottom of the waveform (0)\n");
+    printf("  --high <volts>                    Top of the waveform, or the DC level (5)\n");
+    printf("  --duty <percent>                  PWM duty cycle (50)\n");
+    printf("  --noise <volts>                   Peak noise added to the signal (0)\n");
+    printf("  --seed <n>                        Noise seed (1)\n");
+    printf("  --seconds <s>                     Virtual time to run (10)\n");
+    printf("  --mode scope|voltage|frequency|measure|spectrum|record  Display mode (scope)\n");
+    printf("  --loop-us <us>                    Virtual time per main loop pass (%d)\n", SIM_LOOP_US);
+    printf("  --irq-latency <us>                Fire timer alarms up to this late (0)\n");
+    printf("  --usb <file>                      Send USB output to a file, or - for stdout. Requests are read from stdin.\n");
+    printf("  --stream <file>                   Stream samples to a file, or - for stdout\n");
+    printf("  --stream-rate <samples/s>         Stream sample rate (%d)\n", 1000000000 / STREAM_DEFAULT_INTERVAL_NS);
+    printf("  --dump                            Print the panel when done\n");
+    printf("  --pbm <file>                      Save the panel as a bitmap when done\n");
+}
+
+static bool parseWaveform(const char *name, Waveform &waveform)
+{
+    const char *names[] = { "sine", "square", "pwm", "noise", "dc" };
+    const Waveform waveforms[] = { Waveform::sine, Waveform::square, Waveform::pwm, Waveform::noise, Waveform::dc };
+    for(int index = 0; index < 5; index++)
+    {
+        if(strcmp(name, names[index]) == 0)
+        {
+            waveform = waveforms[index];
+            return true;
+        }
+    }
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    SignalGenerator &signal = simSignal();
+    double seconds = 10;
+    uint32_t loopUs = SIM_LOOP_US;
+    int modePresses = 0;
+    bool dump = false;
+    const char *pbmPath = NULL;
+    const char *usbPath = NULL;
+    bool stream = false;
+    uint32_t streamRate = 1000000000 / STREAM_DEFAULT_INTERVAL_NS;
+
+    for(int arg = 1; arg < argc; arg++)
+    {
+        const char *option = argv[arg];
+        const char *value = (arg + 1 < argc)? argv[arg + 1]: NULL;
+        bool used = true;
+        if(strcmp(option, "--dump") == 0) { dump = true; continue; }
+        if(strcmp(option, "--help") == 0) { usage(); return 0; }
+        if(!value) used = false;
+        else if(strcmp(option, "--wave") == 0) used = parseWaveform(value, signal.waveform);
+        else if(strcmp(option, "--freq") == 0) signal.frequency = atof(value);
+        else if(strcmp(option, "--low") == 0) signal.lowVolts = atof(value);
+        else if(strcmp(option, "--high") == 0) signal.highVolts = atof(value);
+        else if(strcmp(option, "--duty") == 0) signal.dutyPercent = atof(value);
+        else if(strcmp(option, "--noise") == 0) signal.noiseVolts = atof(value);
+        else if(strcmp(option, "--seed") == 0) signal.seed = atoi(value);
+        else if(strcmp(option, "--seconds") == 0) seconds = atof(value);
+        else if(strcmp(option, "--loop-us") == 0) loopUs = atoi(value);
+        else if(strcmp(option, "--irq-latency") == 0) simSetAlarmLatency(atoi(value));
+        else if(strcmp(option, "--pbm") == 0) pbmPath = value;
+        else if(strcmp(option, "--usb") == 0) usbPath = value;
+        else if(strcmp(option, "--stream") == 0) { usbPath = value; stream = true; }
+        else if(strcmp(option, "--stream-rate") == 0) streamRate = atoi(value);
+        else if(strcmp(option, "--mode") == 0)
+        {
+            if(strcmp(value, "scope") == 0) modePresses = 0;
+            else if(strcmp(value, "voltage") == 0) modePresses = 1;
+            else if(strcmp(value, "frequency") == 0) modePresses = 2;
+            else if(strcmp(value, "measure") == 0) modePresses = 3;
+            else if(strcmp(value, "spectrum") == 0) modePresses = 4;
+            else if(strcmp(value, "record") == 0) modePresses = 5;
+            else used = false;
+        }
+        else used = false;
+        if(!used)
+        {
+            usage();
+            return 1;
+        }
+        arg++;
+    }
+    if(loopUs == 0) loopUs = 1;
+    if(streamRate == 0) streamRate = 1;
+
+    // Sending USB output to stdout moves the report to stderr
+    FILE *report = stdout;
+    FILE *usbFile = NULL;
+    if(usbPath && strcmp(usbPath, "-") == 0)
+    {
+        usbFile = stdout;
+        report = stderr;
+    }
+    else if(usbPath && !(usbFile = fopen(usbPath, "wb")))
+    {
+        fprintf(stderr, "Could not write %s\n", usbPath);
+        return 1;
+    }
+    simSetUsbOutput(usbFile);
+
+    // Same start up as the firmware
+    i2c_init(i2c0, 400*1000);
+    disp.external_vcc=false;
+    ssd1306_init(&disp, 128, DISPLAYHEIGHT, 0x3C, i2c0);
+    ssd1306_poweron(&disp);
+    ssd1306_clear(&disp);
+    ssd1306_draw_string(&disp, 2, 4, 2, "BitScanner");
+    ssd1306_show(&disp);
+
+    Scope activeScope;
+    for(int press = 0; press < modePresses; press++) activeScope.toggleDisplayMode();
+    if(stream) activeScope.startStreaming(1000000000 / streamRate);
+
+    auto wallStart = std::chrono::steady_clock::now();
+    uint64_t endNs = seconds * 1e9;
+    while(simTimeNs() < endNs)
+    {
+        activeScope.poll();
+        simRunCore1();
+        simAdvanceUs(loopUs);
+    }
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+    SimStats &stats = simStats();
+    SimPanel &panel = simPanel();
+    fprintf(report, "Simulated %.3f s in %.3f s (%.1fx real time)\n", simTimeNs() / 1e9, wallSeconds, simTimeNs() / 1e9 / wallSeconds);
+    fprintf(report, "Frequency %u Hz, peak %u mV\n", activeScope.getCurrentFrequency(), activeScope.getCurrentMillivolts());
+    fprintf(report, "Timer callbacks %llu, adc reads %llu, adc dma blocks %llu (%llu samples)\n", (unsigned long long)stats.alarmCallbacks,
+        (unsigned long long)stats.adcReads, (unsigned long long)stats.adcDmaBlocks, (unsigned long long)stats.adcDmaSamples);
+    fprintf(report, "Display writes %u (%llu bytes of pixels), i2c bytes %llu\n", panel.dataTransactions,
+        (unsigned long long)panel.dataBytes, (unsigned long long)stats.i2cBytes);
+    if(stream)
+    {
+        fprintf(report, "Streamed %u frames (%llu bytes), %u blocks lost on the device\n", activeScope.getStreamFramesSent(),
+            (unsigned long long)stats.usbBytes, activeScope.getStreamBlocksLost());
+    }
+    if(usbFile)
+    {
+        simSetUsbOutput(NULL);
+        if(usbFile != stdout) fclose(usbFile);
+        else fflush(stdout);
+    }
+    if(dump) panel.dump(report, DISPLAYHEIGHT);
+    if(pbmPath && !panel.writePbm(pbmPath, DISPLAYHEIGHT))
+    {
+        fprintf(stderr, "Could not write %s\n", pbmPath);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,145 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Stress test for SpscQueue. One thread pushes numbered items as fast as it can while another pops them,
+// for long enough that the 16 bit head and tail wrap many times. Every item must arrive once, in order
+// and whole. The sequence numbers are 32 bit and checked by counting, so the check doesn't depend on the
+// queue size dividing 65536. The full and empty edges are also checked on their own across the wrap.
+// Exits with 1 if any check fails.
+
+#include <stdint.h>
+#include <thread>
+#include <atomic>
+#include "SpscQueue.h"
+#include "HostCheck.h"
+
+#define STRESS_ITEMS    1000000     // About 15 wraps of the 16 bit indexes
+
+typedef struct TestItemStruct
+{
+    uint32_t sequence = 0;
+    uint32_t inverse = 0;       // ~sequence, so an item read while half written shows up
+} TestItem;
+
+// Single threaded: the queue holds exactly SIZE items, and full and empty are right at every step,
+// including when head and tail wrap past 65535
+template <uint16_t SIZE>
+static void testEdges()
+{
+    SpscQueue<TestItem, SIZE> queue;
+    TestItem item;
+    uint32_t pushed = 0;
+    uint32_t popped = 0;
+    CHECK(queue.empty() && !queue.full() && !queue.pop(item), "size %u: a new queue isn't empty", SIZE);
+    while(popped < 70000 + SIZE)
+    {
+        // Fill it, then one more must fail
+        while(pushed - popped < SIZE)
+        {
+            item.sequence = pushed;
+            item.inverse = ~pushed;
+            CHECK(!queue.full(), "size %u: full with %u items", SIZE, pushed - popped);
+            CHECK(queue.push(item), "size %u: push failed with %u items", SIZE, pushed - popped);
+            pushed++;
+        }
+        CHECK(queue.full() && !queue.empty(), "size %u: not full with %u items", SIZE, pushed - popped);
+        CHECK(!queue.push(item), "size %u: pushed item %u into a full queue", SIZE, SIZE + 1);
+        // Empty it, in order
+        while(queue.pop(item))
+        {
+            CHECK(item.sequence == popped, "size %u: popped %u, expected %u", SIZE, item.sequence, popped);
+            popped++;
+        }
+        CHECK(popped == pushed && queue.empty() && !queue.full(), "size %u: %u left after emptying", SIZE, pushed - popped);
+        // Leave a few behind so the next round starts somewhere else in the ring
+        for(uint16_t index = 0; index < SIZE / 2 + 1; index++)
+        {
+            item.sequence = pushed;
+            queue.push(item);
+            pushed++;
+        }
+        for(uint16_t index = 0; index < SIZE / 2 + 1; index++)
+        {
+            queue.pop(item);
+            CHECK(item.sequence == popped, "size %u: popped %u, expected %u", SIZE, item.sequence, popped);
+            popped++;
+        }
+    }
+}
+
+// Two threads, as the two cores use it
+template <uint16_t SIZE>
+static void testThreads()
+{
+    static SpscQueue<TestItem, SIZE> queue;
+    std::atomic<uint32_t> pushed{0};
+    uint32_t fullPushes = 0;
+
+    std::thread producer([&]()
+    {
+        for(uint32_t sequence = 0; sequence < STRESS_ITEMS; sequence++)
+        {
+            TestItem item;
+            item.sequence = sequence;
+            item.inverse = ~sequence;
+            while(!queue.push(item))
+            {
+                fullPushes++;
+                std::this_thread::yield();     // The host may have fewer cores than threads
+            }
+            pushed.store(sequence + 1, std::memory_order_release);
+        }
+    });
+
+    uint32_t expected = 0;
+    uint32_t emptyPops = 0;
+    uint32_t errors = 0;
+    while(expected < STRESS_ITEMS)
+    {
+        TestItem item;
+        if(!queue.pop(item))
+        {
+            emptyPops++;
+            std::this_thread::yield();
+            continue;
+        }
+        // Never more out than has gone in. pushed lags the push, so it can only be behind.
+        if(expected >= pushed.load(std::memory_order_acquire) + 1 || item.sequence != expected || item.inverse != ~expected)
+        {
+            if(errors++ < 5) CHECK(false, "size %u: popped %u (%08x), expected %u", SIZE, item.sequence, item.inverse, expected);
+        }
+        expected++;
+    }
+    producer.join();
+    TestItem item;
+    CHECK(!queue.pop(item) && queue.empty(), "size %u: items left after the last", SIZE);
+    CHECK(errors == 0, "size %u: %u items out of order or torn", SIZE, errors);
+    printf("size %3u: %u items, producer found it full %u times, consumer found it empty %u times\n",
+        SIZE, STRESS_ITEMS, fullPushes, emptyPops);
+}
+
+int main()
+{
+    testEdges<2>();
+    testEdges<4>();
+    testEdges<64>();
+    testThreads<2>();
+    testThreads<8>();
+    testThreads<64>();
+    return checkResult("SpscQueue");
+}
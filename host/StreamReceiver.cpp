@@ -0,0 +1,263 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Receives the USB sample stream (see StreamFrame.h) from the device, or from a file or pipe, and writes
+// the samples out as raw 16 bit little endian values or as CSV. Throughput and lost frames are reported
+// on stderr once a second. Opening the serial device starts the stream and exiting stops it.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <chrono>
+#include "StreamFrame.h"
+#include "HostProtocol.h"
+
+#define READ_BUFFER_SIZE    65536
+#define REPORT_US           1000000
+#define DEFAULT_RATE        500000      // The ADC's full speed
+
+typedef struct ReceiverStatsStruct
+{
+    uint64_t frames = 0;
+    uint64_t samples = 0;
+    uint64_t bytes = 0;         // Everything read, including anything skipped
+    uint64_t lostFrames = 0;    // Gaps in the sequence numbers
+    uint64_t skippedBytes = 0;  // Bytes that were not part of a frame
+    uint32_t restarts = 0;      // Times the sequence went back to the start
+} ReceiverStats;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal(int signal)
+{
+    stopRequested = 1;
+}
+
+static void usage()
+{
+    fprintf(stderr, "Usage: bitscanner_rx [options] [device]\n");
+    fprintf(stderr, "  device                Serial device, or - for stdin (/dev/ttyACM0)\n");
+    fprintf(stderr, "  -o <file>             Write the samples to a file, or - for stdout\n");
+    fprintf(stderr, "  --csv                 Write time_us,sample lines instead of raw 16 bit samples\n");
+    fprintf(stderr, "  --rate <samples/s>    Sample rate to stream at (%d)\n", DEFAULT_RATE);
+    fprintf(stderr, "  --seconds <s>         Stop after this long\n");
+    fprintf(stderr, "  --no-control          Don't send the start and stop commands\n");
+    fprintf(stderr, "  --quiet               Only report when done\n");
+}
+
+static double elapsedSeconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const ReceiverStats &stats, double seconds, uint32_t sampleIntervalNs)
+{
+    if(seconds <= 0) seconds = 1e-9;
+    fprintf(stderr, "%8.1f s  %llu frames  %.1f kS/s  %.1f KB/s  lost %llu", seconds, (unsigned long long)stats.frames,
+        stats.samples / seconds / 1000, stats.bytes / seconds / 1024, (unsigned long long)stats.lostFrames);
+    if(sampleIntervalNs > 0) fprintf(stderr, "  (device %.1f kS/s)", 1e6 / sampleIntervalNs);
+    if(stats.skippedBytes > 0) fprintf(stderr, "  skipped %llu bytes", (unsigned long long)stats.skippedBytes);
+    if(stats.restarts > 0) fprintf(stderr, "  restarts %u", stats.restarts);
+    fprintf(stderr, "\n");
+}
+
+// Raw terminal so no byte of the stream is changed or held back
+static bool setRaw(int fd)
+{
+    struct termios tty;
+    if(tcgetattr(fd, &tty) != 0) return false;
+    cfmakeraw(&tty);
+    tty.c_cc[VMIN] = 0;
+    tty.c_cc[VTIME] = 0;
+    return tcsetattr(fd, TCSANOW, &tty) == 0;
+}
+
+// Start (interval) or stop (0) the stream with a binary request. The response is skipped with anything else
+// that isn't a frame.
+static bool sendStreamRequest(int fd, uint32_t sampleIntervalNs)
+{
+    uint8_t payload[4] = { (uint8_t)sampleIntervalNs, (uint8_t)(sampleIntervalNs >> 8), (uint8_t)(sampleIntervalNs >> 16), (uint8_t)(sampleIntervalNs >> 24) };
+    uint8_t request[4 + sizeof(payload)];
+    uint8_t length = buildHostRequest(request, hostStream, payload, sizeof(payload));
+    return write(fd, request, length) == length;
+}
+
+static bool writeSamples(FILE *out, bool csv, const StreamFrameHeader &header, const uint16_t *samples)
+{
+    if(!out) return true;
+    if(csv)
+    {
+        for(uint32_t index = 0; index < header.sampleCount; index++)
+        {
+            double timeUs = header.timestampUs + (double)index * header.sampleIntervalNs / 1000;
+            if(fprintf(out, "%.3f,%u\n", timeUs, samples[index]) < 0) return false;
+        }
+        return true;
+    }
+    uint8_t bytes[STREAM_BLOCK_SAMPLES * 2];
+    for(uint32_t index = 0; index < header.sampleCount; index++)
+    {
+        bytes[index * 2] = samples[index];
+        bytes[index * 2 + 1] = samples[index] >> 8;
+    }
+    return fwrite(bytes, 2, header.sampleCount, out) == header.sampleCount;
+}
+
+static bool validHeader(const StreamFrameHeader &header)
+{
+    return header.magic == STREAM_MAGIC && header.version == STREAM_VERSION && header.format == STREAM_FORMAT_PACKED12 &&
+        header.sampleCount > 0 && header.sampleCount <= STREAM_BLOCK_SAMPLES && header.sampleIntervalNs > 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *devicePath = "/dev/ttyACM0";
+    const char *outputPath = NULL;
+    bool csv = false;
+    bool control = true;
+    bool quiet = false;
+    double seconds = 0;
+    uint32_t rate = DEFAULT_RATE;
+
+    for(int arg = 1; arg < argc; arg++)
+    {
+        const char *option = argv[arg];
+        const char *value = (arg + 1 < argc)? argv[arg + 1]: NULL;
+        if(strcmp(option, "--csv") == 0) csv = true;
+        else if(strcmp(option, "--no-control") == 0) control = false;
+        else if(strcmp(option, "--quiet") == 0) quiet = true;
+        else if(strcmp(option, "--help") == 0) { usage(); return 0; }
+        else if(strcmp(option, "-o") == 0 && value) { outputPath = value; arg++; }
+        else if(strcmp(option, "--seconds") == 0 && value) { seconds = atof(value); arg++; }
+        else if(strcmp(option, "--rate") == 0 && value && atoi(value) > 0) { rate = atoi(value); arg++; }
+        else if(option[0] != '-' || strcmp(option, "-") == 0) devicePath = option;
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    int fd = (strcmp(devicePath, "-") == 0)? STDIN_FILENO: open(devicePath, O_RDWR | O_NOCTTY);
+    if(fd < 0)
+    {
+        fprintf(stderr, "Could not open %s\n", devicePath);
+        return 1;
+    }
+    bool tty = isatty(fd);
+    if(tty && !setRaw(fd))
+    {
+        fprintf(stderr, "Could not set %s to raw mode\n", devicePath);
+        return 1;
+    }
+
+    FILE *out = NULL;
+    if(outputPath && strcmp(outputPath, "-") == 0) out = stdout;
+    else if(outputPath && !(out = fopen(outputPath, csv? "w": "wb")))
+    {
+        fprintf(stderr, "Could not write %s\n", outputPath);
+        return 1;
+    }
+    if(out && csv) fprintf(out, "time_us,sample\n");
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    signal(SIGPIPE, onSignal);
+
+    // Anything the device printed before the stream starts is skipped while looking for the first frame
+    if(tty && control && !sendStreamRequest(fd, 1000000000 / rate))
+    {
+        fprintf(stderr, "Could not start the stream on %s\n", devicePath);
+        return 1;
+    }
+
+    static uint8_t buffer[READ_BUFFER_SIZE];
+    static uint16_t samples[STREAM_BLOCK_SAMPLES];
+    size_t filled = 0;
+    ReceiverStats stats;
+    bool haveSequence = false;
+    uint32_t expectedSequence = 0;
+    uint32_t sampleIntervalNs = 0;
+    auto start = std::chrono::steady_clock::now();
+    double nextReport = REPORT_US / 1e6;
+    bool failed = false;
+
+    while(!stopRequested)
+    {
+        double now = elapsedSeconds(start);
+        if(seconds > 0 && now >= seconds) break;
+        if(!quiet && now >= nextReport)
+        {
+            report(stats, now, sampleIntervalNs);
+            nextReport += REPORT_US / 1e6;
+        }
+
+        struct pollfd input = { fd, POLLIN, 0 };
+        if(poll(&input, 1, 100) <= 0) continue;
+        ssize_t count = read(fd, buffer + filled, sizeof(buffer) - filled);
+        if(count <= 0) break;      // End of file, or the device went away
+        filled += count;
+        stats.bytes += count;
+
+        // Take every complete frame from the buffer
+        size_t position = 0;
+        while(filled - position >= sizeof(StreamFrameHeader))
+        {
+            StreamFrameHeader header;
+            memcpy(&header, buffer + position, sizeof(header));
+            if(!validHeader(header))
+            {
+                position++;
+                stats.skippedBytes++;
+                continue;
+            }
+            size_t frameSize = sizeof(header) + packedSize(header.sampleCount);
+            if(filled - position < frameSize) break;
+            unpackSamples12(buffer + position + sizeof(header), header.sampleCount, samples);
+            position += frameSize;
+
+            if(haveSequence && header.sequence > expectedSequence) stats.lostFrames += header.sequence - expectedSequence;
+            else if(haveSequence && header.sequence < expectedSequence) stats.restarts++;
+            haveSequence = true;
+            expectedSequence = header.sequence + 1;
+            sampleIntervalNs = header.sampleIntervalNs;
+            stats.frames++;
+            stats.samples += header.sampleCount;
+            if(!writeSamples(out, csv, header, samples))
+            {
+                fprintf(stderr, "Could not write the samples\n");
+                failed = true;
+                stopRequested = 1;
+                break;
+            }
+        }
+        memmove(buffer, buffer + position, filled - position);
+        filled -= position;
+    }
+
+    if(tty && control && !sendStreamRequest(fd, 0)) fprintf(stderr, "Could not stop the stream on %s\n", devicePath);
+    if(out && out != stdout) fclose(out);
+    else if(out) fflush(out);
+    report(stats, elapsedSeconds(start), sampleIntervalNs);
+    return (failed || stats.frames == 0)? 1: 0;
+}
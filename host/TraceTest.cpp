@@ -0,0 +1,167 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Checks ssd1306_draw_trace and ssd1306_draw_vspan against the way displayScope drew traces before them:
+// a pixel for the first column and wherever the trace is flat, otherwise a line of pixels from the previous
+// sample to this one. Fixed traces are drawn both ways over the same background and the framebuffers must
+// match byte for byte. Exits with 1 if any check fails.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <cmath>
+#include <initializer_list>
+extern "C"
+{
+    #include "ssd1306.h"
+}
+#include "HostCheck.h"
+
+#define WIDTH       128
+#define HEIGHT      32
+#define TRACE_WIDTH 100
+
+static uint8_t oldBuffer[WIDTH * HEIGHT / 8];
+static uint8_t newBuffer[WIDTH * HEIGHT / 8];
+
+static ssd1306_t makeDisplay(uint8_t *buffer)
+{
+    ssd1306_t display = {};
+    display.width = WIDTH;
+    display.height = HEIGHT;
+    display.pages = HEIGHT / 8;
+    display.buffer = buffer;
+    display.bufsize = WIDTH * HEIGHT / 8;
+    return display;
+}
+
+// The drawing loop from displayScope before ssd1306_draw_trace, with its vertical ssd1306_draw_line a pixel at a time
+static void drawOldTrace(ssd1306_t *p, uint32_t x, const uint8_t *y, uint32_t count)
+{
+    int16_t previousY = -1;
+    for(uint32_t xpos = 0; xpos < count; xpos++)
+    {
+        int16_t newY = y[xpos];
+        if(previousY == -1 || previousY == newY)
+        {
+            ssd1306_draw_pixel(p, x + xpos, newY);
+        }
+        else
+        {
+            int16_t top = (previousY < newY)? previousY: newY;
+            int16_t bottom = (previousY < newY)? newY: previousY;
+            for(int16_t i = top; i <= bottom; i++) ssd1306_draw_pixel(p, x + xpos, i);
+        }
+        previousY = newY;
+    }
+}
+
+// Draws the trace both ways over background and compares. Returns true if they match.
+static bool compareTrace(const char *name, uint32_t x, const uint8_t *y, uint32_t count, uint8_t background)
+{
+    ssd1306_t oldDisplay = makeDisplay(oldBuffer);
+    ssd1306_t newDisplay = makeDisplay(newBuffer);
+    memset(oldBuffer, background, sizeof(oldBuffer));
+    memset(newBuffer, background, sizeof(newBuffer));
+    drawOldTrace(&oldDisplay, x, y, count);
+    ssd1306_draw_trace(&newDisplay, x, y, count);
+    for(uint32_t index = 0; index < sizeof(oldBuffer); index++)
+    {
+        if(oldBuffer[index] != newBuffer[index])
+        {
+            CHECK(false, "%s at x %u: page %u column %u is %02x, the old path drew %02x", name, x,
+                index / WIDTH, index % WIDTH, newBuffer[index], oldBuffer[index]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Each trace is checked on a blank screen and over a pattern, since spans are ORed in like pixels
+static void checkTrace(const char *name, const uint8_t *y, uint32_t count = TRACE_WIDTH)
+{
+    for(uint8_t background : {0x00, 0x81, 0x5A})
+    {
+        if(!compareTrace(name, 0, y, count, background)) return;
+    }
+    // Clipped at the right hand edge
+    compareTrace(name, WIDTH - count / 2, y, count, 0x00);
+}
+
+static void testFixedTraces()
+{
+    uint8_t trace[TRACE_WIDTH];
+    for(uint8_t level : {0, 7, 8, 15, 16, 31})
+    {
+        memset(trace, level, sizeof(trace));
+        checkTrace("flat", trace);
+    }
+    for(uint16_t x = 0; x < TRACE_WIDTH; x++) trace[x] = ((x / 10) & 1)? 0: HEIGHT - 1;
+    checkTrace("square", trace);
+    for(uint16_t x = 0; x < TRACE_WIDTH; x++) trace[x] = x % HEIGHT;
+    checkTrace("sawtooth", trace);
+    for(uint16_t x = 0; x < TRACE_WIDTH; x++) trace[x] = HEIGHT - 1 - (x * 3) % HEIGHT;
+    checkTrace("falling sawtooth", trace);
+    for(uint16_t x = 0; x < TRACE_WIDTH; x++) trace[x] = lround(15.5 + 15.5 * sin(x * 2 * M_PI / 37));
+    checkTrace("sine", trace);
+    trace[0] = 5;
+    checkTrace("single point", trace, 1);
+    // Samples below the screen are clipped the same way
+    for(uint16_t x = 0; x < TRACE_WIDTH; x++) trace[x] = (x & 1)? 20: 40;
+    checkTrace("off screen", trace);
+}
+
+// Every span a column can have - each pair of start and end rows
+static void testAllSpans()
+{
+    uint8_t trace[2];
+    for(uint8_t from = 0; from < HEIGHT; from++)
+    {
+        for(uint8_t to = 0; to < HEIGHT; to++)
+        {
+            trace[0] = from;
+            trace[1] = to;
+            char name[32];
+            snprintf(name, sizeof(name), "span %u to %u", from, to);
+            checkTrace(name, trace, 2);
+        }
+    }
+}
+
+static void testRandomTraces()
+{
+    uint32_t seed = 1;
+    uint8_t trace[TRACE_WIDTH];
+    for(uint16_t pass = 0; pass < 2000; pass++)
+    {
+        for(uint16_t x = 0; x < TRACE_WIDTH; x++)
+        {
+            seed = seed * 1664525 + 1013904223;
+            trace[x] = (seed >> 16) % HEIGHT;
+        }
+        checkTrace("random", trace);
+    }
+}
+
+int main()
+{
+    testFixedTraces();
+    testAllSpans();
+    testRandomTraces();
+    return checkResult("Trace");
+}
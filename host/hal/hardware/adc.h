@@ -0,0 +1,59 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Stand-in for the Pico SDK header of the same name. Only what the firmware uses is declared.
+// The implementations are in host/SimHal.cpp.
+
+#ifndef __HARDWARE_ADC_H__
+#define __HARDWARE_ADC_H__
+
+#include "pico/types.h"
+
+typedef struct
+{
+    volatile uint32_t cs;
+    volatile uint32_t result;
+    volatile uint32_t fcs;
+    volatile uint32_t fifo;
+    volatile uint32_t div;
+    volatile uint32_t intr;
+    volatile uint32_t inte;
+    volatile uint32_t intf;
+    volatile uint32_t ints;
+} adc_hw_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern adc_hw_t *const adc_hw;
+
+void adc_init(void);
+void adc_gpio_init(uint gpio);
+void adc_select_input(uint input);
+uint16_t adc_read(void);
+void adc_run(bool run);
+void adc_set_clkdiv(float clkdiv);
+void adc_fifo_setup(bool en, bool dreq_en, uint16_t dreq_thresh, bool err_in_fifo, bool byte_shift);
+void adc_fifo_drain(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,83 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Stand-in for the Pico SDK header of the same name. Only what the firmware uses is declared.
+// The implementations are in host/SimHal.cpp.
+
+#ifndef __HARDWARE_DMA_H__
+#define __HARDWARE_DMA_H__
+
+#include "pico/types.h"
+
+#define NUM_DMA_CHANNELS    12
+#define DREQ_I2C0_TX        32
+#define DREQ_I2C1_TX        34
+#define DREQ_ADC            36
+#define DREQ_FORCE          63
+
+enum dma_channel_transfer_size
+{
+    DMA_SIZE_8 = 0,
+    DMA_SIZE_16 = 1,
+    DMA_SIZE_32 = 2
+};
+
+typedef struct
+{
+    uint32_t ctrl;
+} dma_channel_config;
+
+typedef struct
+{
+    volatile uint32_t intr;
+    volatile uint32_t ints0;
+    volatile uint32_t ints1;
+} dma_hw_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern dma_hw_t *const dma_hw;
+
+int dma_claim_unused_channel(bool required);
+void dma_channel_unclaim(uint channel);
+dma_channel_config dma_channel_get_default_config(uint channel);
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size);
+void channel_config_set_read_increment(dma_channel_config *c, bool incr);
+void channel_config_set_write_increment(dma_channel_config *c, bool incr);
+void channel_config_set_dreq(dma_channel_config *c, uint dreq);
+void channel_config_set_chain_to(dma_channel_config *c, uint chain_to);
+void channel_config_set_ring(dma_channel_config *c, bool write, uint size_bits);
+void dma_channel_set_config(uint channel, const dma_channel_config *config, bool trigger);
+void dma_channel_set_write_addr(uint channel, volatile void *write_addr, bool trigger);
+void dma_channel_start(uint channel);
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr, const volatile void *read_addr, uint transfer_count, bool trigger);
+void dma_channel_set_irq0_enabled(uint channel, bool enabled);
+void dma_channel_acknowledge_irq0(uint channel);
+void dma_channel_set_irq1_enabled(uint channel, bool enabled);
+void dma_channel_acknowledge_irq1(uint channel);
+bool dma_channel_get_irq1_status(uint channel);
+void dma_channel_abort(uint channel);
+bool dma_channel_is_busy(uint channel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
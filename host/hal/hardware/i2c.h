@@ -0,0 +1,49 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Stand-in for the Pico SDK header of the same name. Only what the firmware uses is declared.
+// The implementations are in host/SimHal.cpp.
+
+#ifndef __HARDWARE_I2C_H__
+#define __HARDWARE_I2C_H__
+
+#include "pico/types.h"
+#include "hardware/structs/i2c.h"
+
+typedef struct i2c_inst
+{
+    i2c_hw_t *hw;
+} i2c_inst_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern i2c_inst_t i2c0_inst;
+#define i2c0 (&i2c0_inst)
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate);
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop);
+static inline i2c_hw_t *i2c_get_hw(i2c_inst_t *i2c) { return i2c->hw; }
+static inline uint i2c_get_dreq(i2c_inst_t *i2c, bool is_tx) { (void)i2c; return is_tx? 32: 33; }    // DREQ_I2C0_TX / DREQ_I2C0_RX
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,43 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Stand-in for the Pico SDK header of the same name. Only what the firmware uses is declared.
+// The implementations are in host/SimHal.cpp.
+
+#ifndef __HARDWARE_IRQ_H__
+#define __HARDWARE_IRQ_H__
+
+#include "pico/types.h"
+
+#define DMA_IRQ_0   11
+#define DMA_IRQ_1   12
+
+typedef void (*irq_handler_t)(void);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler);
+void irq_set_enabled(uint num, bool enabled);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,59 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Stand-in for the Pico SDK header of the same name. Only what the firmware uses is declared.
+// The implementations are in host/SimHal.cpp.
+
+#ifndef __HARDWARE_PWM_H__
+#define __HARDWARE_PWM_H__
+
+#include "pico/types.h"
+
+enum pwm_clkdiv_mode
+{
+    PWM_DIV_FREE_RUNNING = 0,
+    PWM_DIV_B_HIGH = 1,
+    PWM_DIV_B_RISING = 2,
+    PWM_DIV_B_FALLING = 3
+};
+
+typedef struct
+{
+    uint32_t csr;
+    uint32_t div;
+    uint32_t top;
+} pwm_config;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static inline uint pwm_gpio_to_slice_num(uint gpio) { return (gpio >> 1) & 7; }
+pwm_config pwm_get_default_config(void);
+void pwm_config_set_clkdiv_mode(pwm_config *c, enum pwm_clkdiv_mode mode);
+void pwm_config_set_clkdiv(pwm_config *c, float div);
+void pwm_init(uint slice_num, pwm_config *c, bool start);
+void pwm_set_counter(uint slice_num, uint16_t c);
+uint16_t pwm_get_counter(uint slice_num);
+void pwm_set_enabled(uint slice_num, bool enabled);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
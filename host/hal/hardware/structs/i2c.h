@@ -0,0 +1,67 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Stand-in for the Pico SDK header of the same name. Only what the firmware uses is declared.
+// The implementations are in host/SimHal.cpp.
+
+#ifndef __HARDWARE_STRUCTS_I2C_H__
+#define __HARDWARE_STRUCTS_I2C_H__
+
+#include "pico/types.h"
+
+#define I2C_IC_DATA_CMD_STOP_BITS           0x00000200u
+#define I2C_IC_STATUS_ACTIVITY_BITS         0x00000001u
+#define I2C_IC_STATUS_TFE_BITS              0x00000004u
+#define I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS   0x00000040u
+
+// Register layout matches the RP2040 so the firmware's writes land where it expects
+typedef struct
+{
+    volatile uint32_t con;
+    volatile uint32_t tar;
+    volatile uint32_t sar;
+    uint32_t _pad0;
+    volatile uint32_t data_cmd;
+    volatile uint32_t ss_scl_hcnt;
+    volatile uint32_t ss_scl_lcnt;
+    volatile uint32_t fs_scl_hcnt;
+    volatile uint32_t fs_scl_lcnt;
+    uint32_t _pad1[2];
+    volatile uint32_t intr_stat;
+    volatile uint32_t intr_mask;
+    volatile uint32_t raw_intr_stat;
+    volatile uint32_t rx_tl;
+    volatile uint32_t tx_tl;
+    volatile uint32_t clr_intr;
+    volatile uint32_t clr_rx_under;
+    volatile uint32_t clr_rx_over;
+    volatile uint32_t clr_tx_over;
+    volatile uint32_t clr_rd_req;
+    volatile uint32_t clr_tx_abrt;
+    volatile uint32_t clr_rx_done;
+    volatile uint32_t clr_activity;
+    volatile uint32_t clr_stop_det;
+    volatile uint32_t clr_start_det;
+    volatile uint32_t clr_gen_call;
+    volatile uint32_t enable;
+    volatile uint32_t status;
+    volatile uint32_t txflr;
+    volatile uint32_t rxflr;
+} i2c_hw_t;
+
+#endif
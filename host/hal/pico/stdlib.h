@@ -0,0 +1,44 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Stand-in for the Pico SDK header of the same name. Only what the firmware uses is declared.
+// The implementations are in host/SimHal.cpp.
+
+#ifndef __PICO_STDLIB_H__
+#define __PICO_STDLIB_H__
+
+#include <stdio.h>
+#include "pico/types.h"
+#include "pico/time.h"
+#include "pico/stdio.h"
+#include "hardware/gpio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void stdio_init_all(void);
+
+// Busy-wait hook. On the simulated core1 it yields to the scheduler, on core0 it lets time pass.
+void tight_loop_contents(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,57 @@
+/*
+    Bitscanner - a LittleBits compatible combination oscilloscope, voltmeter and frequency counter
+    Copyright (C) 2025 by Dan Appleman
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Stand-in for the Pico SDK header of the same name. Only what the firmware uses is declared.
+// The implementations are in host/SimHal.cpp.
+
+#ifndef __PICO_TIME_H__
+#define __PICO_TIME_H__
+
+#include "pico/types.h"
+#include "hardware/timer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct alarm_pool alarm_pool_t;
+struct repeating_timer;
+typedef bool (*repeating_timer_callback_t)(struct repeating_timer *rt);
+
+struct repeating_timer
+{
+    int64_t delay_us;
+    alarm_pool_t *pool;
+    int32_t alarm_id;
+    repeating_timer_callback_t callback;
+    void *user_data;
+};
+
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+
+alarm_pool_t *alarm_pool_create_with_unused_hardware_alarm(uint max_timers);
+bool alarm_pool_add_repeating_timer_us(alarm_pool_t *pool, int64_t delay_us, repeating_timer_callback_t callback, void *user_data, struct repeating_timer *out);
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback, void *user_data, struct repeating_timer *out);
+bool cancel_repeating_timer(struct repeating_timer *timer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
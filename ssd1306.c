@@ -34,11 +34,15 @@ SOFTWARE.
 #include "font.h"
 
 inline static void swap(int32_t *a, int32_t *b) {
-    int32_t *t=a;
+    int32_t t=*a;
     *a=*b;
-    *b=*t;
+    *b=t;
 }
 
+// bits at and below / at and above each bit position within a page byte
+static const uint8_t mask_from[8]= {0xFF, 0xFE, 0xFC, 0xF8, 0xF0, 0xE0, 0xC0, 0x80};
+static const uint8_t mask_to[8]= {0x01, 0x03, 0x07, 0x0F, 0x1F, 0x3F, 0x7F, 0xFF};
+
 inline static void fancy_write(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, char *name) {
     switch(i2c_write_blocking(i2c, addr, src, len, false)) {
     case PICO_ERROR_GENERIC:
@@ -53,9 +57,23 @@ inline static void fancy_write(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src
     }
 }
 
+// send a list of commands in a single transaction. At most sizeof(d)-1 commands - any more are dropped
+// rather than written past the buffer.
+static void ssd1306_write_cmds(ssd1306_t *p, const uint8_t *cmds, size_t len) {
+    uint8_t d[32];
+    if(len>sizeof(d)-1)
+        len=sizeof(d)-1;
+    while(ssd1306_busy(p))
+        tight_loop_contents();
+
+    d[0]=0x00;
+    memcpy(d+1, cmds, len);
+    fancy_write(p->i2c_i, p->address, d, len+1, "ssd1306_write");
+    p->bytes_sent+=len+1;
+}
+
 inline static void ssd1306_write(ssd1306_t *p, uint8_t val) {
-    uint8_t d[2]= {0x00, val};
-    fancy_write(p->i2c_i, p->address, d, 2, "ssd1306_write");
+    ssd1306_write_cmds(p, &val, 1);
 }
 
 bool ssd1306_init(ssd1306_t *p, uint16_t width, uint16_t height, uint8_t address, i2c_inst_t *i2c_instance) {
@@ -75,6 +93,23 @@ bool ssd1306_init(ssd1306_t *p, uint16_t width, uint16_t height, uint8_t address
 
     ++(p->buffer);
 
+    if((p->shadow=malloc(p->bufsize))==NULL) {
+        free(p->buffer-1);
+        p->bufsize=0;
+        return false;
+    }
+    p->shadow_valid=false;
+    p->bytes_sent=0;
+
+    // worst case every page is sent: control byte and 6 commands, then control byte and the page
+    if((p->tx=malloc(p->pages*(p->width+8)*sizeof(uint32_t)))==NULL) {
+        free(p->buffer-1);
+        free(p->shadow);
+        p->bufsize=0;
+        return false;
+    }
+    p->dma_channel=dma_claim_unused_channel(true);
+
     // from https://github.com/makerportal/rpi-pico-ssd1306
     uint8_t cmds[]= {
         SET_DISP,
@@ -109,14 +144,18 @@ bool ssd1306_init(ssd1306_t *p, uint16_t width, uint16_t height, uint8_t address
         0x00,  // horizontal
     };
 
-    for(size_t i=0; i<sizeof(cmds); ++i)
-        ssd1306_write(p, cmds[i]);
+    ssd1306_write_cmds(p, cmds, sizeof(cmds));
 
     return true;
 }
 
 inline void ssd1306_deinit(ssd1306_t *p) {
+    while(ssd1306_busy(p))
+        tight_loop_contents();
+    dma_channel_unclaim(p->dma_channel);
     free(p->buffer-1);
+    free(p->shadow);
+    free(p->tx);
 }
 
 inline void ssd1306_poweroff(ssd1306_t *p) {
@@ -128,8 +167,8 @@ inline void ssd1306_poweron(ssd1306_t *p) {
 }
 
 inline void ssd1306_contrast(ssd1306_t *p, uint8_t val) {
-    ssd1306_write(p, SET_CONTRAST);
-    ssd1306_write(p, val);
+    uint8_t cmds[]= {SET_CONTRAST, val};
+    ssd1306_write_cmds(p, cmds, sizeof(cmds));
 }
 
 inline void ssd1306_invert(ssd1306_t *p, uint8_t inv) {
@@ -152,6 +191,37 @@ void ssd1306_draw_pixel(ssd1306_t *p, uint32_t x, uint32_t y) {
     p->buffer[x+p->width*(y>>3)]|=0x1<<(y&0x07); // y>>3==y/8 && y&0x7==y%8
 }
 
+void ssd1306_draw_vspan(ssd1306_t *p, uint32_t x, uint32_t y1, uint32_t y2) {
+    if(y1>y2) {
+        uint32_t t=y1;
+        y1=y2;
+        y2=t;
+    }
+    if(x>=p->width || y1>=p->height)
+        return;
+    if(y2>=p->height)
+        y2=p->height-1;
+
+    uint8_t *column=p->buffer+x;
+    uint32_t page=y1>>3, last_page=y2>>3;
+    if(page==last_page) {
+        column[page*p->width]|=mask_from[y1&7] & mask_to[y2&7];
+        return;
+    }
+    column[page*p->width]|=mask_from[y1&7];
+    while(++page<last_page)
+        column[page*p->width]=0xFF;
+    column[last_page*p->width]|=mask_to[y2&7];
+}
+
+void ssd1306_draw_trace(ssd1306_t *p, uint32_t x, const uint8_t *y, uint32_t count) {
+    if(count==0)
+        return;
+    ssd1306_draw_vspan(p, x, y[0], y[0]);
+    for(uint32_t i=1; i<count; ++i)
+        ssd1306_draw_vspan(p, x+i, y[i-1], y[i]);
+}
+
 void ssd1306_draw_line(ssd1306_t *p, int32_t x1, int32_t y1, int32_t x2, int32_t y2) {
     if(x1>x2) {
         swap(&x1, &x2);
@@ -159,18 +229,30 @@ void ssd1306_draw_line(ssd1306_t *p, int32_t x1, int32_t y1, int32_t x2, int32_t
     }
 
     if(x1==x2) {
-        if(y1>y2)
-            swap(&y1, &y2);
-        for(int32_t i=y1; i<=y2; ++i)
-            ssd1306_draw_pixel(p, x1, i);
+        if(x1<0 || (y1<0 && y2<0))
+            return;
+        ssd1306_draw_vspan(p, x1, y1<0?0:y1, y2<0?0:y2);
         return;
     }
 
-    float m=(float) (y2-y1) / (float) (x2-x1);
-
-    for(int32_t i=x1; i<=x2; ++i) {
-        float y=m*(float) (i-x1)+(float) y1;
-        ssd1306_draw_pixel(p, i, (uint32_t) y);
+    // bresenham
+    int32_t dx=x2-x1;
+    int32_t dy=y2>y1?y2-y1:y1-y2;
+    int32_t step=y2>y1?1:-1;
+    int32_t err=dx-dy;
+    for(;;) {
+        ssd1306_draw_pixel(p, x1, y1);
+        if(x1==x2 && y1==y2)
+            break;
+        int32_t e2=2*err;
+        if(e2>-dy) {
+            err-=dy;
+            x1++;
+        }
+        if(e2<dx) {
+            err+=dx;
+            y1+=step;
+        }
     }
 }
 
@@ -290,17 +372,88 @@ inline void ssd1306_bmp_show_image(ssd1306_t *p, const uint8_t *data, const long
     ssd1306_bmp_show_image_with_offset(p, data, size, 0, 0);
 }
 
-void ssd1306_show(ssd1306_t *p) {
-    uint8_t payload[]= {SET_COL_ADDR, 0, p->width-1, SET_PAGE_ADDR, 0, p->pages-1};
-    if(p->width==64) {
-        payload[1]+=32;
-        payload[2]+=32;
+// build the i2c data_cmd words for every changed window: a command transaction setting the window,
+// then a data transaction. the controller starts a new transaction after each stop by itself
+static size_t ssd1306_build_tx(ssd1306_t *p) {
+    uint32_t *out=p->tx;
+    uint8_t col_offset=(p->width==64)?32:0;
+
+    for(uint8_t page=0; page<p->pages; ++page) {
+        uint8_t *row=p->buffer+page*p->width;
+        uint8_t *shadow_row=p->shadow+page*p->width;
+
+        // find the dirty column range of this page
+        int32_t first=0, last=p->width-1;
+        if(p->shadow_valid) {
+            while(first<p->width && row[first]==shadow_row[first])
+                ++first;
+            if(first==p->width)
+                continue;
+            while(row[last]==shadow_row[last])
+                --last;
+        }
+
+        uint8_t payload[]= {SET_COL_ADDR, first+col_offset, last+col_offset, SET_PAGE_ADDR, page, page};
+        *out++=0x00;
+        for(size_t i=0; i<sizeof(payload); ++i)
+            *out++=payload[i];
+        out[-1]|=I2C_IC_DATA_CMD_STOP_BITS;
+
+        *out++=0x40;
+        for(int32_t x=first; x<=last; ++x)
+            *out++=row[x];
+        out[-1]|=I2C_IC_DATA_CMD_STOP_BITS;
+
+        memcpy(shadow_row+first, row+first, last-first+1);
+    }
+    p->shadow_valid=true;
+    p->bytes_sent+=out-p->tx;
+    return out-p->tx;
+}
+
+bool ssd1306_busy(ssd1306_t *p) {
+    i2c_hw_t *hw=i2c_get_hw(p->i2c_i);
+    if(hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS) {
+        // not acknowledged. the controller flushed its fifo, so drop the rest and resend everything next time
+        dma_channel_abort(p->dma_channel);
+        (void) hw->clr_tx_abrt;
+        p->shadow_valid=false;
+        return false;
     }
+    if(dma_channel_is_busy(p->dma_channel))
+        return true;
+    return !(hw->status & I2C_IC_STATUS_TFE_BITS) || (hw->status & I2C_IC_STATUS_ACTIVITY_BITS);
+}
+
+bool ssd1306_show_async(ssd1306_t *p) {
+    if(ssd1306_busy(p))
+        return false;
 
-    for(size_t i=0; i<sizeof(payload); ++i)
-        ssd1306_write(p, payload[i]);
+    size_t len=ssd1306_build_tx(p);
+    if(len==0)
+        return true;
+
+    i2c_hw_t *hw=i2c_get_hw(p->i2c_i);
+    hw->enable=0;
+    hw->tar=p->address;
+    hw->enable=1;
+
+    dma_channel_config c=dma_channel_get_default_config(p->dma_channel);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, i2c_get_dreq(p->i2c_i, true));
+    dma_channel_configure(p->dma_channel, &c, &hw->data_cmd, p->tx, len, true);
+    return true;
+}
 
-    *(p->buffer-1)=0x40;
+inline void ssd1306_invalidate(ssd1306_t *p) {
+    p->shadow_valid=false;
+}
 
-    fancy_write(p->i2c_i, p->address, p->buffer-1, p->bufsize+1, "ssd1306_show");
+void ssd1306_show(ssd1306_t *p) {
+    while(!ssd1306_show_async(p))
+        tight_loop_contents();
+    while(ssd1306_busy(p))
+        tight_loop_contents();
 }
@@ -32,6 +32,7 @@ SOFTWARE.
 #define _inc_ssd1306
 #include <pico/stdlib.h>
 #include <hardware/i2c.h>
+#include <hardware/dma.h>
 
 /**
 *	@brief defines commands used in ssd1306
@@ -68,6 +69,11 @@ typedef struct {
     bool external_vcc; 	/**< whether display uses external vcc */ 
     uint8_t *buffer;	/**< display buffer */
     size_t bufsize;		/**< buffer size */
+    uint8_t *shadow;	/**< copy of what the panel currently shows */
+    bool shadow_valid;	/**< false until the whole panel has been written once */
+    uint32_t bytes_sent;	/**< total bytes sent over i2c, to measure the cost of updates */
+    int dma_channel;	/**< dma channel feeding the i2c tx fifo */
+    uint32_t *tx;		/**< i2c data_cmd words for the frame being sent. lets the buffer be redrawn during a transfer */
 } ssd1306_t;
 
 /**
@@ -130,11 +136,45 @@ void ssd1306_invert(ssd1306_t *p, uint8_t inv);
 /**
 	@brief display buffer, should be called on change
 
+	only the columns of each page that differ from what the panel already shows are sent
+
 	@param[in] p : instance of display
 
 */
 void ssd1306_show(ssd1306_t *p);
 
+/**
+	@brief start sending the display buffer without waiting for it
+
+	the changed windows are copied into a transfer buffer that dma streams to the i2c controller,
+	so the display buffer may be redrawn as soon as this returns
+
+	@param[in] p : instance of display
+
+	@return bool.
+	@retval true if the update was started (or there was nothing to send)
+	@retval false if the previous update is still being sent
+*/
+bool ssd1306_show_async(ssd1306_t *p);
+
+/**
+	@brief check whether an update is still being sent
+
+	@param[in] p : instance of display
+
+	@return bool.
+	@retval true while an update started by ssd1306_show_async is in progress
+*/
+bool ssd1306_busy(ssd1306_t *p);
+
+/**
+	@brief forget what the panel shows, so the next ssd1306_show sends the whole buffer
+
+	@param[in] p : instance of display
+
+*/
+void ssd1306_invalidate(ssd1306_t *p);
+
 /**
 	@brief clear display buffer
 
@@ -172,6 +212,26 @@ void ssd1306_draw_pixel(ssd1306_t *p, uint32_t x, uint32_t y);
 */
 void ssd1306_draw_line(ssd1306_t *p, int32_t x1, int32_t y1, int32_t x2, int32_t y2);
 
+/**
+	@brief draw vertical span on buffer by setting whole page bytes at a time
+
+	@param[in] p : instance of display
+	@param[in] x : x position
+	@param[in] y1 : y position of one end (inclusive)
+	@param[in] y2 : y position of other end (inclusive)
+*/
+void ssd1306_draw_vspan(ssd1306_t *p, uint32_t x, uint32_t y1, uint32_t y2);
+
+/**
+	@brief draw waveform trace. each column is a vertical span joining the previous point to this one
+
+	@param[in] p : instance of display
+	@param[in] x : x position of first point
+	@param[in] y : y position of each point
+	@param[in] count : number of points
+*/
+void ssd1306_draw_trace(ssd1306_t *p, uint32_t x, const uint8_t *y, uint32_t count);
+
 /**
 	@brief clear square at given position with given size
 
@@ -22,6 +22,7 @@
 #include "hardware/timer.h"
 #include "hardware/watchdog.h"
 #include "Scope.h"
+#include "Profiler.h"
 
 extern "C"
 {
@@ -31,6 +32,7 @@ extern "C"
 
 const uint LED_PIN = 25;
 const uint MODE_PIN = 15;
+#define LONG_PRESS_US 600000    // Holding the mode switch this long is a long press
 
 // I2C defines
 // This example will use I2C0 on GPIO8 (SDA) and GPIO9 (SCL) running at 400KHz.
@@ -45,6 +47,7 @@ int main()
 {
     sleep_ms(10);  // Some setup time
     stdio_init_all();
+    PROFILE_START_CORE();
     gpio_init(LED_PIN);
     gpio_set_dir(LED_PIN, GPIO_OUT);
 
@@ -73,7 +76,7 @@ int main()
     // second arg is pause on debug which means the watchdog will pause when stepping through code
     watchdog_enable(2000, 1);
     
-    Scope activeScope;
+    static Scope activeScope;   // Static - its capture buffers are too big for the main stack
 
 
  
@@ -94,6 +97,8 @@ int main()
     bool stableMode = true;
     bool lastMode = true;
     uint64_t lastModeCheck = time_us_64();
+    uint64_t pressTime = 0;
+    bool longPressSent = false;
 
 
 
@@ -107,7 +112,7 @@ int main()
             gpio_put(LED_PIN, ledstate);
             led_time = current_time;
             printf("Frequency: %d\n", activeScope.getCurrentFrequency());
-            printf("Voltage: %f\n", activeScope.getCurrentVoltage());
+            printf("Millivolts: %d\n", activeScope.getCurrentMillivolts());
         }
         */
 
@@ -140,9 +145,20 @@ int main()
                 // It's stable
                 debouncingMode = false;
                 stableMode = currentMode;
-                if(stableMode == 0) activeScope.toggleDisplayMode();    // On button press, toggle the display
+                if(stableMode == 0)
+                {
+                    pressTime = current_time;
+                    longPressSent = false;
+                }
+                else if(!longPressSent) activeScope.shortPress();   // Released before it became a long press
             }
         }
+        // A long press acts as soon as it has been held long enough, without waiting for the release
+        if(stableMode == 0 && !longPressSent && current_time - pressTime > LONG_PRESS_US)
+        {
+            activeScope.longPress();
+            longPressSent = true;
+        }
 
 
     }